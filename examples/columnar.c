@@ -0,0 +1,222 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libdivecomputer/buffer.h>
+
+#include "columnar.h"
+
+struct dctool_columnar_t {
+	dc_buffer_t *buffer;
+	size_t offset;
+};
+
+static unsigned int
+columnar_uint16 (const unsigned char data[])
+{
+	return data[0] | (data[1] << 8);
+}
+
+static unsigned int
+columnar_uint32 (const unsigned char data[])
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int) data[3] << 24);
+}
+
+static double
+columnar_float32 (const unsigned char data[])
+{
+	unsigned int bits = columnar_uint32 (data);
+	float value = 0;
+	memcpy (&value, &bits, sizeof (value));
+	return value;
+}
+
+dctool_columnar_t *
+dctool_columnar_open (const char *filename)
+{
+	dctool_columnar_t *reader = (dctool_columnar_t *) malloc (sizeof (dctool_columnar_t));
+	if (reader == NULL)
+		return NULL;
+
+	// Map the entire file into memory.
+	reader->buffer = dc_buffer_new_mapped (filename);
+	if (reader->buffer == NULL) {
+		free (reader);
+		return NULL;
+	}
+
+	// Verify the file header.
+	const unsigned char *data = dc_buffer_get_data (reader->buffer);
+	size_t size = dc_buffer_get_size (reader->buffer);
+	if (size < DCTOOL_COLUMNAR_SZ_HEADER ||
+		memcmp (data, DCTOOL_COLUMNAR_MAGIC, 4) != 0 ||
+		columnar_uint16 (data + 4) != DCTOOL_COLUMNAR_VERSION) {
+		dc_buffer_free (reader->buffer);
+		free (reader);
+		return NULL;
+	}
+
+	reader->offset = DCTOOL_COLUMNAR_SZ_HEADER;
+
+	return reader;
+}
+
+void
+dctool_columnar_close (dctool_columnar_t *reader)
+{
+	if (reader == NULL)
+		return;
+
+	dc_buffer_free (reader->buffer);
+	free (reader);
+}
+
+dc_status_t
+dctool_columnar_next (dctool_columnar_t *reader, dctool_columnar_dive_t *dive)
+{
+	if (reader == NULL || dive == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	const unsigned char *data = dc_buffer_get_data (reader->buffer);
+	size_t size = dc_buffer_get_size (reader->buffer);
+
+	if (reader->offset == size)
+		return DC_STATUS_DONE;
+
+	if (reader->offset + DCTOOL_COLUMNAR_SZ_DIVE > size)
+		return DC_STATUS_DATAFORMAT;
+
+	const unsigned char *record = data + reader->offset;
+	unsigned int length = columnar_uint32 (record);
+	if (length < DCTOOL_COLUMNAR_SZ_DIVE || (length % 8) != 0 ||
+		length > size - reader->offset)
+		return DC_STATUS_DATAFORMAT;
+
+	dive->record = record;
+	dive->size = length;
+	dive->number = columnar_uint32 (record + 4);
+	dive->nsamples = columnar_uint32 (record + 8);
+	dive->ncolumns = columnar_uint32 (record + 12);
+	dive->datetime.year = columnar_uint16 (record + 16);
+	dive->datetime.month = record[18];
+	dive->datetime.day = record[19];
+	dive->datetime.hour = record[20];
+	dive->datetime.minute = record[21];
+	dive->datetime.second = record[22];
+	dive->fsize = record[23];
+	dive->datetime.timezone = (int) columnar_uint32 (record + 24);
+	dive->divetime = columnar_uint32 (record + 28);
+	dive->maxdepth = columnar_float32 (record + 32);
+	dive->divemode = columnar_uint32 (record + 36);
+	dive->fingerprint = dive->fsize ? record + DCTOOL_COLUMNAR_SZ_DIVE : NULL;
+
+	// Locate the column directory.
+	unsigned int offset = DCTOOL_COLUMNAR_SZ_DIVE + ((dive->fsize + 7) & ~7u);
+	if (dive->ncolumns > (length - DCTOOL_COLUMNAR_SZ_DIVE) / DCTOOL_COLUMNAR_SZ_COLUMN ||
+		offset + dive->ncolumns * DCTOOL_COLUMNAR_SZ_COLUMN > length)
+		return DC_STATUS_DATAFORMAT;
+
+	dive->directory = record + offset;
+
+	reader->offset += length;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dctool_columnar_get_column (const dctool_columnar_dive_t *dive, unsigned int n, dctool_columnar_column_t *column)
+{
+	if (dive == NULL || column == NULL || n >= dive->ncolumns)
+		return DC_STATUS_INVALIDARGS;
+
+	const unsigned char *entry = dive->directory + n * DCTOOL_COLUMNAR_SZ_COLUMN;
+	unsigned int count = columnar_uint32 (entry + 8);
+	unsigned int offset = columnar_uint32 (entry + 12);
+	if ((offset % 8) != 0 || offset > dive->size || count > (dive->size - offset) / 4)
+		return DC_STATUS_DATAFORMAT;
+
+	column->id = (dctool_columnar_id_t) columnar_uint16 (entry + 0);
+	column->index = columnar_uint16 (entry + 2);
+	column->type = (dctool_columnar_type_t) entry[4];
+	column->encoding = (dctool_columnar_encoding_t) entry[5];
+	column->count = count;
+	column->data = dive->record + offset;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dctool_columnar_find_column (const dctool_columnar_dive_t *dive, dctool_columnar_id_t id, unsigned int index, dctool_columnar_column_t *column)
+{
+	if (dive == NULL || column == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	for (unsigned int i = 0; i < dive->ncolumns; ++i) {
+		const unsigned char *entry = dive->directory + i * DCTOOL_COLUMNAR_SZ_COLUMN;
+		if (columnar_uint16 (entry + 0) == id && columnar_uint16 (entry + 2) == index)
+			return dctool_columnar_get_column (dive, i, column);
+	}
+
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dctool_columnar_column_decode (const dctool_columnar_column_t *column, double values[], unsigned int count)
+{
+	if (column == NULL || values == NULL || count < column->count)
+		return DC_STATUS_INVALIDARGS;
+
+	double scale = 1.0;
+	if (column->encoding == DCTOOL_COLUMNAR_DELTA && column->id == DCTOOL_COLUMNAR_DEPTH)
+		scale = 1000.0;
+
+	long long accumulator = 0;
+	for (unsigned int i = 0; i < column->count; ++i) {
+		const unsigned char *p = column->data + i * 4;
+		unsigned int raw = columnar_uint32 (p);
+
+		if (column->encoding == DCTOOL_COLUMNAR_DELTA) {
+			accumulator += (int) raw;
+			values[i] = accumulator / scale;
+			continue;
+		}
+
+		switch (column->type) {
+		case DCTOOL_COLUMNAR_UINT32:
+			values[i] = raw == DCTOOL_COLUMNAR_UNDEFINED ? NAN : raw;
+			break;
+		case DCTOOL_COLUMNAR_INT32:
+			values[i] = (int) raw;
+			break;
+		case DCTOOL_COLUMNAR_FLOAT32:
+			values[i] = columnar_float32 (p);
+			break;
+		default:
+			return DC_STATUS_DATAFORMAT;
+		}
+	}
+
+	return DC_STATUS_SUCCESS;
+}
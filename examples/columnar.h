@@ -0,0 +1,144 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DCTOOL_COLUMNAR_H
+#define DCTOOL_COLUMNAR_H
+
+#include <libdivecomputer/common.h>
+#include <libdivecomputer/datetime.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Columnar binary dive format.
+ *
+ * All values are stored in little endian byte order and in SI units
+ * (seconds, meters, bar, degrees Celsius). The file starts with a 16 byte
+ * header (magic, version, flags), followed by one record per dive. Each
+ * record is aligned on an 8 byte boundary and contains:
+ *
+ *   - a fixed size dive header (DCTOOL_COLUMNAR_SZ_DIVE bytes),
+ *   - the fingerprint, padded to a multiple of 8 bytes,
+ *   - the column directory (DCTOOL_COLUMNAR_SZ_COLUMN bytes per column),
+ *   - the column data, each column aligned on an 8 byte boundary.
+ *
+ * The sample columns have one value per sample (a sample starts with
+ * every DC_SAMPLE_TIME value). Missing values are stored as NaN for the
+ * floating point columns, and as 0xFFFFFFFF for the integer columns. The
+ * event columns have one value per event instead.
+ *
+ * With the delta encoding, the time column contains the difference with
+ * the previous sample (in seconds), and the depth column contains the
+ * difference with the previous sample in millimeters. A missing depth is
+ * encoded as a zero difference.
+ */
+
+#define DCTOOL_COLUMNAR_MAGIC   "DCCF"
+#define DCTOOL_COLUMNAR_VERSION 1
+
+#define DCTOOL_COLUMNAR_SZ_HEADER 16
+#define DCTOOL_COLUMNAR_SZ_DIVE   40
+#define DCTOOL_COLUMNAR_SZ_COLUMN 16
+
+#define DCTOOL_COLUMNAR_UNDEFINED 0xFFFFFFFF
+
+typedef enum dctool_columnar_id_t {
+	DCTOOL_COLUMNAR_TIME = 1,
+	DCTOOL_COLUMNAR_DEPTH,
+	DCTOOL_COLUMNAR_PRESSURE,
+	DCTOOL_COLUMNAR_TEMPERATURE,
+	DCTOOL_COLUMNAR_RBT,
+	DCTOOL_COLUMNAR_HEARTBEAT,
+	DCTOOL_COLUMNAR_BEARING,
+	DCTOOL_COLUMNAR_SETPOINT,
+	DCTOOL_COLUMNAR_PPO2,
+	DCTOOL_COLUMNAR_CNS,
+	DCTOOL_COLUMNAR_GASMIX,
+	DCTOOL_COLUMNAR_DECO_TYPE,
+	DCTOOL_COLUMNAR_DECO_TIME,
+	DCTOOL_COLUMNAR_DECO_DEPTH,
+	DCTOOL_COLUMNAR_EVENT_TIME,
+	DCTOOL_COLUMNAR_EVENT_TYPE,
+	DCTOOL_COLUMNAR_EVENT_FLAGS,
+	DCTOOL_COLUMNAR_EVENT_VALUE
+} dctool_columnar_id_t;
+
+typedef enum dctool_columnar_type_t {
+	DCTOOL_COLUMNAR_UINT32 = 1,
+	DCTOOL_COLUMNAR_INT32,
+	DCTOOL_COLUMNAR_FLOAT32
+} dctool_columnar_type_t;
+
+typedef enum dctool_columnar_encoding_t {
+	DCTOOL_COLUMNAR_PLAIN = 0,
+	DCTOOL_COLUMNAR_DELTA
+} dctool_columnar_encoding_t;
+
+typedef struct dctool_columnar_t dctool_columnar_t;
+
+typedef struct dctool_columnar_column_t {
+	dctool_columnar_id_t id;
+	unsigned int index;
+	dctool_columnar_type_t type;
+	dctool_columnar_encoding_t encoding;
+	unsigned int count;
+	const unsigned char *data;
+} dctool_columnar_column_t;
+
+typedef struct dctool_columnar_dive_t {
+	unsigned int number;
+	unsigned int nsamples;
+	unsigned int ncolumns;
+	dc_datetime_t datetime;
+	unsigned int divetime;
+	double maxdepth;
+	unsigned int divemode;
+	const unsigned char *fingerprint;
+	unsigned int fsize;
+	const unsigned char *directory;
+	const unsigned char *record;
+	unsigned int size;
+} dctool_columnar_dive_t;
+
+dctool_columnar_t *
+dctool_columnar_open (const char *filename);
+
+void
+dctool_columnar_close (dctool_columnar_t *reader);
+
+dc_status_t
+dctool_columnar_next (dctool_columnar_t *reader, dctool_columnar_dive_t *dive);
+
+dc_status_t
+dctool_columnar_get_column (const dctool_columnar_dive_t *dive, unsigned int n, dctool_columnar_column_t *column);
+
+dc_status_t
+dctool_columnar_find_column (const dctool_columnar_dive_t *dive, dctool_columnar_id_t id, unsigned int index, dctool_columnar_column_t *column);
+
+dc_status_t
+dctool_columnar_column_decode (const dctool_columnar_column_t *column, double values[], unsigned int count);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DCTOOL_COLUMNAR_H */
@@ -188,6 +188,20 @@ dctool_descriptor_search (dc_descriptor_t **out, const char *name, dc_family_t f
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
 
+	// Search by family and model number.
+	if (name == NULL) {
+		dc_descriptor_t *descriptor = NULL;
+		rc = dc_descriptor_find (&descriptor, family, model);
+		if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
+			ERROR ("Error searching the device descriptors.");
+			return rc;
+		}
+
+		*out = descriptor;
+
+		return DC_STATUS_SUCCESS;
+	}
+
 	dc_iterator_t *iterator = NULL;
 	rc = dc_descriptor_iterator (&iterator);
 	if (rc != DC_STATUS_SUCCESS) {
@@ -197,36 +211,18 @@ dctool_descriptor_search (dc_descriptor_t **out, const char *name, dc_family_t f
 
 	dc_descriptor_t *descriptor = NULL, *current = NULL;
 	while ((rc = dc_iterator_next (iterator, &descriptor)) == DC_STATUS_SUCCESS) {
-		if (name) {
-			const char *vendor = dc_descriptor_get_vendor (descriptor);
-			const char *product = dc_descriptor_get_product (descriptor);
-
-			size_t n = strlen (vendor);
-			if (strncasecmp (name, vendor, n) == 0 && name[n] == ' ' &&
-				strcasecmp (name + n + 1, product) == 0)
-			{
-				current = descriptor;
-				break;
-			} else if (strcasecmp (name, product) == 0) {
-				current = descriptor;
-				break;
-			}
-		} else {
-			if (family == dc_descriptor_get_type (descriptor)) {
-				if (model == dc_descriptor_get_model (descriptor)) {
-					// Exact match found. Return immediately.
-					dc_descriptor_free (current);
-					current = descriptor;
-					break;
-				} else {
-					// Possible match found. Keep searching for an exact match.
-					// If no exact match is found, the first match is returned.
-					if (current == NULL) {
-						current = descriptor;
-						descriptor = NULL;
-					}
-				}
-			}
+		const char *vendor = dc_descriptor_get_vendor (descriptor);
+		const char *product = dc_descriptor_get_product (descriptor);
+
+		size_t n = strlen (vendor);
+		if (strncasecmp (name, vendor, n) == 0 && name[n] == ' ' &&
+			strcasecmp (name + n + 1, product) == 0)
+		{
+			current = descriptor;
+			break;
+		} else if (strcasecmp (name, product) == 0) {
+			current = descriptor;
+			break;
 		}
 
 		dc_descriptor_free (descriptor);
@@ -312,6 +308,14 @@ dctool_file_read (const char *filename)
 {
 	FILE *fp = NULL;
 
+	// Map regular files directly into memory. This avoids copying large
+	// memory dumps onto the heap, and allows the page cache to be shared.
+	if (filename) {
+		dc_buffer_t *mapped = dc_buffer_new_mapped (filename);
+		if (mapped)
+			return mapped;
+	}
+
 	// Open the file.
 	if (filename) {
 		fp = fopen (filename, "rb");
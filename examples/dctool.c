@@ -28,6 +28,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <signal.h>
+#include <math.h>
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
 #endif
@@ -61,10 +62,12 @@ static const dctool_command_t *g_commands[] = {
 	&dctool_download,
 	&dctool_dump,
 	&dctool_parse,
+	&dctool_inspect,
 	&dctool_read,
 	&dctool_write,
 	&dctool_timesync,
 	&dctool_fwupdate,
+	&dctool_session,
 	NULL
 };
 
@@ -110,6 +113,9 @@ dctool_command_showhelp (const dctool_command_t *command)
 			"   -f, --family <family>     Device family type\n"
 			"   -m, --model <model>       Device model number\n"
 			"   -l, --logfile <logfile>   Logfile\n"
+			"   -c, --capture <file>      Record the I/O to a capture file\n"
+			"   -r, --replay <file>       Replay the I/O from a capture file\n"
+			"   -s, --speed <speed>       Replay speed (0 for no delays)\n"
 			"   -q, --quiet               Quiet mode\n"
 			"   -v, --verbose             Verbose mode\n"
 #else
@@ -118,6 +124,9 @@ dctool_command_showhelp (const dctool_command_t *command)
 			"   -f <family>    Family type\n"
 			"   -m <model>     Model number\n"
 			"   -l <logfile>   Logfile\n"
+			"   -c <file>      Record the I/O to a capture file\n"
+			"   -r <file>      Replay the I/O from a capture file\n"
+			"   -s <speed>     Replay speed (0 for no delays)\n"
 			"   -q             Quiet mode\n"
 			"   -v             Verbose mode\n"
 #endif
@@ -173,6 +182,10 @@ main (int argc, char *argv[])
 	unsigned int help = 0;
 	dc_loglevel_t loglevel = DC_LOGLEVEL_WARNING;
 	const char *logfile = NULL;
+	const char *capture = NULL;
+	const char *replay = NULL;
+	double speed = 1.0;
+	char *end = NULL;
 	const char *device = NULL;
 	dc_family_t family = DC_FAMILY_NULL;
 	unsigned int model = 0;
@@ -180,7 +193,7 @@ main (int argc, char *argv[])
 
 	// Parse the command-line options.
 	int opt = 0;
-	const char *optstring = NOPERMUTATION "hd:f:m:l:qv";
+	const char *optstring = NOPERMUTATION "hd:f:m:l:c:r:s:qv";
 #ifdef HAVE_GETOPT_LONG
 	struct option options[] = {
 		{"help",        no_argument,       0, 'h'},
@@ -188,6 +201,9 @@ main (int argc, char *argv[])
 		{"family",      required_argument, 0, 'f'},
 		{"model",       required_argument, 0, 'm'},
 		{"logfile",     required_argument, 0, 'l'},
+		{"capture",     required_argument, 0, 'c'},
+		{"replay",      required_argument, 0, 'r'},
+		{"speed",       required_argument, 0, 's'},
 		{"quiet",       no_argument,       0, 'q'},
 		{"verbose",     no_argument,       0, 'v'},
 		{0,             0,                 0,  0 }
@@ -214,6 +230,19 @@ main (int argc, char *argv[])
 		case 'l':
 			logfile = optarg;
 			break;
+		case 'c':
+			capture = optarg;
+			break;
+		case 'r':
+			replay = optarg;
+			break;
+		case 's':
+			speed = strtod (optarg, &end);
+			if (end == optarg || *end != '\0' || !isfinite (speed) || speed < 0.0) {
+				message ("Invalid replay speed %s.\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
 		case 'q':
 			loglevel = DC_LOGLEVEL_NONE;
 			break;
@@ -275,6 +304,20 @@ main (int argc, char *argv[])
 	dc_context_set_loglevel (context, loglevel);
 	dc_context_set_logfunc (context, logfunc, NULL);
 
+	// Setup the I/O capture.
+	if (capture || replay) {
+		if (replay) {
+			status = dc_context_set_replay (context, replay, speed);
+		} else {
+			status = dc_context_set_capture (context, capture);
+		}
+		if (status != DC_STATUS_SUCCESS) {
+			message ("Failed to open the capture file.\n");
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+	}
+
 	if (command->config & DCTOOL_CONFIG_DESCRIPTOR) {
 		// Check mandatory arguments.
 		if (device == NULL && family == DC_FAMILY_NULL) {
@@ -48,10 +48,12 @@ extern const dctool_command_t dctool_list;
 extern const dctool_command_t dctool_download;
 extern const dctool_command_t dctool_dump;
 extern const dctool_command_t dctool_parse;
+extern const dctool_command_t dctool_inspect;
 extern const dctool_command_t dctool_read;
 extern const dctool_command_t dctool_write;
 extern const dctool_command_t dctool_timesync;
 extern const dctool_command_t dctool_fwupdate;
+extern const dctool_command_t dctool_session;
 
 const dctool_command_t *
 dctool_command_find (const char *name);
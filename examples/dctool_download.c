@@ -30,6 +30,10 @@
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
 #endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <time.h>
+#endif
 
 #include <libdivecomputer/context.h>
 #include <libdivecomputer/descriptor.h>
@@ -46,36 +50,46 @@ typedef struct event_data_t {
 	dc_event_devinfo_t devinfo;
 } event_data_t;
 
+#define QUEUE_SIZE 16
+
+typedef struct dive_t {
+	dc_buffer_t *data;
+	dc_buffer_t *fingerprint;
+} dive_t;
+
 typedef struct dive_data_t {
 	dc_device_t *device;
 	dc_buffer_t **fingerprint;
 	unsigned int number;
 	dctool_output_t *output;
+	dc_status_t status;
+#ifdef HAVE_PTHREAD_H
+	// The dives are parsed and written by a worker thread, such that the
+	// download is not stalled by the output. The queue between the two
+	// threads is bounded, to limit the memory usage when the output is
+	// slower than the download.
+	unsigned int threaded;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t notempty;
+	pthread_cond_t notfull;
+	dive_t queue[QUEUE_SIZE];
+	unsigned int head;
+	unsigned int count;
+	unsigned int done;
+	// Queue statistics.
+	unsigned int maxcount;
+	double stalltime;
+	double idletime;
+#endif
 } dive_data_t;
 
-static int
-dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+static void
+dive_parse (dive_data_t *divedata, const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize)
 {
-	dive_data_t *divedata = (dive_data_t *) userdata;
 	dc_status_t rc = DC_STATUS_SUCCESS;
 	dc_parser_t *parser = NULL;
 
-	divedata->number++;
-
-	message ("Dive: number=%u, size=%u, fingerprint=", divedata->number, size);
-	for (unsigned int i = 0; i < fsize; ++i)
-		message ("%02X", fingerprint[i]);
-	message ("\n");
-
-	// Keep a copy of the most recent fingerprint. Because dives are
-	// guaranteed to be downloaded in reverse order, the most recent
-	// dive is always the first dive.
-	if (divedata->number == 1) {
-		dc_buffer_t *fp = dc_buffer_new (fsize);
-		dc_buffer_append (fp, fingerprint, fsize);
-		*divedata->fingerprint = fp;
-	}
-
 	// Create the parser.
 	message ("Creating the parser.\n");
 	rc = dc_parser_new (&parser, divedata->device);
@@ -102,6 +116,177 @@ dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fing
 
 cleanup:
 	dc_parser_destroy (parser);
+}
+
+#ifdef HAVE_PTHREAD_H
+static double
+dive_clock (void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#else
+	return 0.0;
+#endif
+}
+
+static void *
+dive_worker (void *userdata)
+{
+	dive_data_t *divedata = (dive_data_t *) userdata;
+
+	pthread_mutex_lock (&divedata->mutex);
+	for (;;) {
+		// Wait for the next dive.
+		if (divedata->count == 0 && !divedata->done) {
+			double begin = dive_clock ();
+			while (divedata->count == 0 && !divedata->done)
+				pthread_cond_wait (&divedata->notempty, &divedata->mutex);
+			divedata->idletime += dive_clock () - begin;
+		}
+
+		// Stop once the queue is drained after the download.
+		if (divedata->count == 0)
+			break;
+
+		dive_t dive = divedata->queue[divedata->head];
+		divedata->head = (divedata->head + 1) % QUEUE_SIZE;
+		divedata->count--;
+		pthread_cond_signal (&divedata->notfull);
+		pthread_mutex_unlock (&divedata->mutex);
+
+		dive_parse (divedata,
+			dc_buffer_get_data (dive.data), dc_buffer_get_size (dive.data),
+			dc_buffer_get_data (dive.fingerprint), dc_buffer_get_size (dive.fingerprint));
+
+		dc_buffer_free (dive.data);
+		dc_buffer_free (dive.fingerprint);
+
+		pthread_mutex_lock (&divedata->mutex);
+	}
+	pthread_mutex_unlock (&divedata->mutex);
+
+	return NULL;
+}
+
+static void
+dive_worker_start (dive_data_t *divedata)
+{
+	divedata->threaded = 0;
+	divedata->head = 0;
+	divedata->count = 0;
+	divedata->done = 0;
+	divedata->maxcount = 0;
+	divedata->stalltime = 0.0;
+	divedata->idletime = 0.0;
+
+	pthread_mutex_init (&divedata->mutex, NULL);
+	pthread_cond_init (&divedata->notempty, NULL);
+	pthread_cond_init (&divedata->notfull, NULL);
+
+	// Without a worker thread, the dives are parsed in the callback.
+	if (pthread_create (&divedata->thread, NULL, dive_worker, divedata) != 0) {
+		WARNING ("Error creating the worker thread.");
+		return;
+	}
+
+	divedata->threaded = 1;
+}
+
+static void
+dive_worker_stop (dive_data_t *divedata)
+{
+	if (divedata->threaded) {
+		pthread_mutex_lock (&divedata->mutex);
+		divedata->done = 1;
+		pthread_cond_signal (&divedata->notempty);
+		pthread_mutex_unlock (&divedata->mutex);
+
+		pthread_join (divedata->thread, NULL);
+
+		message ("Queue: size=%u, maxdepth=%u, stall=%.3fs, idle=%.3fs\n",
+			QUEUE_SIZE, divedata->maxcount, divedata->stalltime, divedata->idletime);
+	}
+
+	pthread_cond_destroy (&divedata->notfull);
+	pthread_cond_destroy (&divedata->notempty);
+	pthread_mutex_destroy (&divedata->mutex);
+}
+
+static int
+dive_enqueue (dive_data_t *divedata, const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize)
+{
+	// The data is only valid during the callback.
+	dive_t dive;
+	dive.data = dc_buffer_new (size);
+	dive.fingerprint = dc_buffer_new (fsize);
+	if (!dc_buffer_append (dive.data, data, size) ||
+		!dc_buffer_append (dive.fingerprint, fingerprint, fsize)) {
+		ERROR ("Error allocating the dive data.");
+		dc_buffer_free (dive.data);
+		dc_buffer_free (dive.fingerprint);
+		return 0;
+	}
+
+	pthread_mutex_lock (&divedata->mutex);
+
+	// Wait for a free slot.
+	if (divedata->count == QUEUE_SIZE) {
+		double begin = dive_clock ();
+		while (divedata->count == QUEUE_SIZE)
+			pthread_cond_wait (&divedata->notfull, &divedata->mutex);
+		divedata->stalltime += dive_clock () - begin;
+	}
+
+	divedata->queue[(divedata->head + divedata->count) % QUEUE_SIZE] = dive;
+	divedata->count++;
+	if (divedata->maxcount < divedata->count)
+		divedata->maxcount = divedata->count;
+
+	pthread_cond_signal (&divedata->notempty);
+	pthread_mutex_unlock (&divedata->mutex);
+
+	return 1;
+}
+#endif
+
+static int
+dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+{
+	dive_data_t *divedata = (dive_data_t *) userdata;
+
+	divedata->number++;
+
+	// Format the fingerprint first, such that the line is written with
+	// a single call and can't interleave with the output of the worker.
+	char hex[2 * 64 + 1] = {0};
+	for (unsigned int i = 0; i < fsize && i < (sizeof (hex) - 1) / 2; ++i)
+		snprintf (hex + 2 * i, 3, "%02X", fingerprint[i]);
+	message ("Dive: number=%u, size=%u, fingerprint=%s\n", divedata->number, size, hex);
+
+	// Keep a copy of the most recent fingerprint. Because dives are
+	// guaranteed to be downloaded in reverse order, the most recent
+	// dive is always the first dive.
+	if (divedata->number == 1) {
+		dc_buffer_t *fp = dc_buffer_new (fsize);
+		dc_buffer_append (fp, fingerprint, fsize);
+		*divedata->fingerprint = fp;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	if (divedata->threaded) {
+		if (!dive_enqueue (divedata, data, size, fingerprint, fsize)) {
+			// Abort the download and report the failure afterwards.
+			divedata->status = DC_STATUS_NOMEMORY;
+			return 0;
+		}
+		return 1;
+	}
+#endif
+
+	dive_parse (divedata, data, size, fingerprint, fsize);
+
 	return 1;
 }
 
@@ -210,10 +395,26 @@ download (dc_context_t *context, dc_descriptor_t *descriptor, const char *devnam
 	divedata.fingerprint = &ofingerprint;
 	divedata.number = 0;
 	divedata.output = output;
+	divedata.status = DC_STATUS_SUCCESS;
+
+#ifdef HAVE_PTHREAD_H
+	dive_worker_start (&divedata);
+#endif
 
 	// Download the dives.
 	message ("Downloading the dives.\n");
 	rc = dc_device_foreach (device, dive_cb, &divedata);
+
+#ifdef HAVE_PTHREAD_H
+	// Wait until all queued dives are written.
+	dive_worker_stop (&divedata);
+#endif
+
+	// A dive that could not be queued stops the download early, but
+	// the foreach function still reports success.
+	if (rc == DC_STATUS_SUCCESS)
+		rc = divedata.status;
+
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR ("Error downloading the dives.");
 		goto cleanup;
@@ -316,6 +517,10 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 		output = dctool_raw_output_new (filename);
 	} else if (strcasecmp(format, "xml") == 0) {
 		output = dctool_xml_output_new (filename, units);
+	} else if (strcasecmp(format, "columnar") == 0) {
+		output = dctool_columnar_output_new (filename, 0);
+	} else if (strcasecmp(format, "columnar-delta") == 0) {
+		output = dctool_columnar_output_new (filename, 1);
 	} else {
 		message ("Unknown output format: %s\n", format);
 		exitcode = EXIT_FAILURE;
@@ -378,6 +583,12 @@ const dctool_command_t dctool_download = {
 	"      files, the filename is interpreted as a template and should\n"
 	"      contain one or more placeholders.\n"
 	"\n"
+	"   COLUMNAR, COLUMNAR-DELTA\n"
+	"\n"
+	"      All dives are exported to a single binary file, with the samples\n"
+	"      stored in typed columns (SI units). The delta variant stores the\n"
+	"      time and depth columns as differences (depth in millimeters).\n"
+	"\n"
 	"Supported template placeholders:\n"
 	"\n"
 	"   %f   Fingerprint (hexadecimal format)\n"
@@ -39,11 +39,63 @@
 #include "common.h"
 #include "utils.h"
 
+typedef struct event_data_t {
+	const char *cachedir;
+	dc_event_devinfo_t devinfo;
+} event_data_t;
+
+static void
+event_cb (dc_device_t *device, dc_event_type_t event, const void *data, void *userdata)
+{
+	const dc_event_devinfo_t *devinfo = (const dc_event_devinfo_t *) data;
+
+	event_data_t *eventdata = (event_data_t *) userdata;
+
+	// Forward to the default event handler.
+	dctool_event_cb (device, event, data, userdata);
+
+	switch (event) {
+	case DC_EVENT_DEVINFO:
+		// Load the memory dump from the cache. If there is no memory
+		// dump present in the cache, a NULL buffer is returned, and
+		// the registered cache will be cleared.
+		if (eventdata->cachedir) {
+			char filename[1024] = {0};
+			dc_family_t family = DC_FAMILY_NULL;
+			dc_buffer_t *cache = NULL;
+
+			// Generate the cache filename.
+			family = dc_device_get_type (device);
+			snprintf (filename, sizeof (filename), "%s/%s-%08X.mem",
+				eventdata->cachedir, dctool_family_name (family), devinfo->serial);
+
+			// Read the cache file.
+			cache = dctool_file_read (filename);
+
+			// Register the cache data.
+			dc_device_set_cache (device,
+				dc_buffer_get_data (cache),
+				dc_buffer_get_size (cache));
+
+			// Free the buffer again.
+			dc_buffer_free (cache);
+		}
+
+		// Keep a copy of the event data. It will be used for generating
+		// the cache filename again after a (successful) download.
+		eventdata->devinfo = *devinfo;
+		break;
+	default:
+		break;
+	}
+}
+
 static dc_status_t
-dump (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, dc_buffer_t *fingerprint, dc_buffer_t *buffer)
+dump (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, const char *cachedir, dc_buffer_t *fingerprint, dc_buffer_t *buffer)
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
 	dc_device_t *device = NULL;
+	event_data_t eventdata = {0};
 
 	// Open the device.
 	message ("Opening the device (%s %s, %s).\n",
@@ -58,8 +110,9 @@ dump (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, d
 
 	// Register the event handler.
 	message ("Registering the event handler.\n");
+	eventdata.cachedir = cachedir;
 	int events = DC_EVENT_WAITING | DC_EVENT_PROGRESS | DC_EVENT_DEVINFO | DC_EVENT_CLOCK | DC_EVENT_VENDOR;
-	rc = dc_device_set_events (device, events, dctool_event_cb, NULL);
+	rc = dc_device_set_events (device, events, event_cb, &eventdata);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR ("Error registering the event handler.");
 		goto cleanup;
@@ -91,6 +144,20 @@ dump (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, d
 		goto cleanup;
 	}
 
+	// Store the memory dump in the cache.
+	if (cachedir) {
+		char filename[1024] = {0};
+		dc_family_t family = DC_FAMILY_NULL;
+
+		// Generate the cache filename.
+		family = dc_device_get_type (device);
+		snprintf (filename, sizeof (filename), "%s/%s-%08X.mem",
+			cachedir, dctool_family_name (family), eventdata.devinfo.serial);
+
+		// Write the cache file.
+		dctool_file_write (filename, buffer);
+	}
+
 cleanup:
 	dc_device_close (device);
 	return rc;
@@ -108,15 +175,17 @@ dctool_dump_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 	unsigned int help = 0;
 	const char *fphex = NULL;
 	const char *filename = NULL;
+	const char *cachedir = NULL;
 
 	// Parse the command-line options.
 	int opt = 0;
-	const char *optstring = "ho:p:";
+	const char *optstring = "ho:p:c:";
 #ifdef HAVE_GETOPT_LONG
 	struct option options[] = {
 		{"help",        no_argument,       0, 'h'},
 		{"output",      required_argument, 0, 'o'},
 		{"fingerprint", required_argument, 0, 'p'},
+		{"cache",       required_argument, 0, 'c'},
 		{0,             0,                 0,  0 }
 	};
 	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
@@ -133,6 +202,9 @@ dctool_dump_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 		case 'p':
 			fphex = optarg;
 			break;
+		case 'c':
+			cachedir = optarg;
+			break;
 		default:
 			return EXIT_FAILURE;
 		}
@@ -154,7 +226,7 @@ dctool_dump_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 	buffer = dc_buffer_new (0);
 
 	// Download the memory dump.
-	status = dump (context, descriptor, argv[0], fingerprint, buffer);
+	status = dump (context, descriptor, argv[0], cachedir, fingerprint, buffer);
 	if (status != DC_STATUS_SUCCESS) {
 		message ("ERROR: %s\n", dctool_errmsg (status));
 		exitcode = EXIT_FAILURE;
@@ -183,9 +255,11 @@ const dctool_command_t dctool_dump = {
 	"   -h, --help                 Show help message\n"
 	"   -o, --output <filename>    Output filename\n"
 	"   -p, --fingerprint <data>   Fingerprint data (hexadecimal)\n"
+	"   -c, --cache <directory>    Cache directory\n"
 #else
 	"   -h                 Show help message\n"
 	"   -o <filename>      Output filename\n"
 	"   -p <fingerprint>   Fingerprint data (hexadecimal)\n"
+	"   -c <directory>     Cache directory\n"
 #endif
 };
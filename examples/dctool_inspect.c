@@ -0,0 +1,212 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <math.h>
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/descriptor.h>
+
+#include "dctool.h"
+#include "columnar.h"
+#include "common.h"
+#include "utils.h"
+
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
+static const char *g_names[] = {
+	NULL,
+	"time",
+	"depth",
+	"pressure",
+	"temperature",
+	"rbt",
+	"heartbeat",
+	"bearing",
+	"setpoint",
+	"ppo2",
+	"cns",
+	"gasmix",
+	"deco.type",
+	"deco.time",
+	"deco.depth",
+	"event.time",
+	"event.type",
+	"event.flags",
+	"event.value",
+};
+
+static dc_status_t
+inspect_column (const dctool_columnar_column_t *column)
+{
+	const char *name = NULL;
+	if (column->id < C_ARRAY_SIZE (g_names))
+		name = g_names[column->id];
+
+	double *values = (double *) malloc ((column->count ? column->count : 1) * sizeof (double));
+	if (values == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	dc_status_t rc = dctool_columnar_column_decode (column, values, column->count);
+	if (rc != DC_STATUS_SUCCESS) {
+		free (values);
+		return rc;
+	}
+
+	// Scan the column for the range of the defined values.
+	unsigned int count = 0;
+	double minimum = 0.0, maximum = 0.0;
+	for (unsigned int i = 0; i < column->count; ++i) {
+		if (isnan (values[i]))
+			continue;
+		if (count == 0 || values[i] < minimum)
+			minimum = values[i];
+		if (count == 0 || values[i] > maximum)
+			maximum = values[i];
+		count++;
+	}
+
+	printf ("   %s[%u]: count=%u, defined=%u, min=%.2f, max=%.2f%s\n",
+		name ? name : "unknown", column->index, column->count, count,
+		minimum, maximum,
+		column->encoding == DCTOOL_COLUMNAR_DELTA ? ", delta" : "");
+
+	free (values);
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+inspect (const char *filename)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	// Open the columnar file.
+	dctool_columnar_t *reader = dctool_columnar_open (filename);
+	if (reader == NULL) {
+		ERROR ("Error opening the columnar file.");
+		return DC_STATUS_IO;
+	}
+
+	dctool_columnar_dive_t dive;
+	while ((rc = dctool_columnar_next (reader, &dive)) == DC_STATUS_SUCCESS) {
+		printf ("Dive: number=%u, datetime=%04i-%02i-%02i %02i:%02i:%02i, divetime=%02u:%02u, maxdepth=%.2f, samples=%u\n",
+			dive.number,
+			dive.datetime.year, dive.datetime.month, dive.datetime.day,
+			dive.datetime.hour, dive.datetime.minute, dive.datetime.second,
+			dive.divetime / 60, dive.divetime % 60, dive.maxdepth,
+			dive.nsamples);
+
+		for (unsigned int i = 0; i < dive.ncolumns; ++i) {
+			dctool_columnar_column_t column;
+			rc = dctool_columnar_get_column (&dive, i, &column);
+			if (rc == DC_STATUS_SUCCESS)
+				rc = inspect_column (&column);
+			if (rc != DC_STATUS_SUCCESS) {
+				ERROR ("Error decoding the columns.");
+				goto cleanup;
+			}
+		}
+	}
+
+	if (rc != DC_STATUS_DONE) {
+		ERROR ("Error reading the columnar file.");
+		goto cleanup;
+	}
+
+	rc = DC_STATUS_SUCCESS;
+
+cleanup:
+	dctool_columnar_close (reader);
+	return rc;
+}
+
+static int
+dctool_inspect_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t *descriptor)
+{
+	// Default option values.
+	unsigned int help = 0;
+
+	// Parse the command-line options.
+	int opt = 0;
+	const char *optstring = "h";
+#ifdef HAVE_GETOPT_LONG
+	struct option options[] = {
+		{"help",        no_argument,       0, 'h'},
+		{0,             0,                 0,  0 }
+	};
+	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
+#else
+	while ((opt = getopt (argc, argv, optstring)) != -1) {
+#endif
+		switch (opt) {
+		case 'h':
+			help = 1;
+			break;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	// Show help message.
+	if (help) {
+		dctool_command_showhelp (&dctool_inspect);
+		return EXIT_SUCCESS;
+	}
+
+	for (unsigned int i = 0; i < argc; ++i) {
+		dc_status_t status = inspect (argv[i]);
+		if (status != DC_STATUS_SUCCESS) {
+			message ("ERROR: %s\n", dctool_errmsg (status));
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+const dctool_command_t dctool_inspect = {
+	dctool_inspect_run,
+	DCTOOL_CONFIG_NONE,
+	"inspect",
+	"Show the contents of a columnar dive file",
+	"Usage:\n"
+	"   dctool inspect [options] <filename>\n"
+	"\n"
+	"Options:\n"
+#ifdef HAVE_GETOPT_LONG
+	"   -h, --help   Show help message\n"
+#else
+	"   -h   Show help message\n"
+#endif
+};
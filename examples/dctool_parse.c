@@ -94,16 +94,18 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 	const char *filename = NULL;
 	unsigned int devtime = 0;
 	dc_ticks_t systime = 0;
+	const char *format = "xml";
 
 	// Parse the command-line options.
 	int opt = 0;
-	const char *optstring = "ho:d:s:u:";
+	const char *optstring = "ho:d:s:f:u:";
 #ifdef HAVE_GETOPT_LONG
 	struct option options[] = {
 		{"help",        no_argument,       0, 'h'},
 		{"output",      required_argument, 0, 'o'},
 		{"devtime",     required_argument, 0, 'd'},
 		{"systime",     required_argument, 0, 's'},
+		{"format",      required_argument, 0, 'f'},
 		{"units",       required_argument, 0, 'u'},
 		{0,             0,                 0,  0 }
 	};
@@ -124,6 +126,9 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 		case 's':
 			systime = strtoll (optarg, NULL, 0);
 			break;
+		case 'f':
+			format = optarg;
+			break;
 		case 'u':
 			if (strcmp (optarg, "metric") == 0)
 				units = DCTOOL_UNITS_METRIC;
@@ -145,7 +150,17 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 	}
 
 	// Create the output.
-	output = dctool_xml_output_new (filename, units);
+	if (strcasecmp(format, "xml") == 0) {
+		output = dctool_xml_output_new (filename, units);
+	} else if (strcasecmp(format, "columnar") == 0) {
+		output = dctool_columnar_output_new (filename, 0);
+	} else if (strcasecmp(format, "columnar-delta") == 0) {
+		output = dctool_columnar_output_new (filename, 1);
+	} else {
+		message ("Unknown output format: %s\n", format);
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
 	if (output == NULL) {
 		message ("Failed to create the output.\n");
 		exitcode = EXIT_FAILURE;
@@ -194,12 +209,14 @@ const dctool_command_t dctool_parse = {
 	"   -o, --output <filename>    Output filename\n"
 	"   -d, --devtime <timestamp>  Device time\n"
 	"   -s, --systime <timestamp>  System time\n"
+	"   -f, --format <format>      Output format (xml or columnar)\n"
 	"   -u, --units <units>        Set units (metric or imperial)\n"
 #else
 	"   -h              Show help message\n"
 	"   -o <filename>   Output filename\n"
 	"   -d <devtime>    Device time\n"
 	"   -s <systime>    System time\n"
+	"   -f <format>     Output format (xml or columnar)\n"
 	"   -u <units>      Set units (metric or imperial)\n"
 #endif
 };
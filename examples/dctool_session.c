@@ -0,0 +1,452 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#endif
+
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/descriptor.h>
+#include <libdivecomputer/device.h>
+#include <libdivecomputer/parser.h>
+
+#include "dctool.h"
+#include "common.h"
+#include "output.h"
+#include "utils.h"
+
+#define MAXARGS 8
+
+typedef enum session_result_t {
+	SESSION_CONTINUE,
+	SESSION_QUIT,
+	SESSION_SHUTDOWN
+} session_result_t;
+
+typedef struct session_t {
+	dc_device_t *device;
+	dc_buffer_t *fingerprint;
+} session_t;
+
+typedef struct dive_data_t {
+	dc_device_t *device;
+	dc_buffer_t *fingerprint;
+	unsigned int number;
+	dctool_output_t *output;
+	dc_status_t status;
+} dive_data_t;
+
+static int
+dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+{
+	dive_data_t *divedata = (dive_data_t *) userdata;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_parser_t *parser = NULL;
+
+	divedata->number++;
+
+	message ("Dive: number=%u, size=%u\n", divedata->number, size);
+
+	// Keep a copy of the most recent fingerprint.
+	if (divedata->number == 1) {
+		dc_buffer_clear (divedata->fingerprint);
+		dc_buffer_append (divedata->fingerprint, fingerprint, fsize);
+	}
+
+	// Parse the dive data.
+	rc = dc_parser_new (&parser, divedata->device);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR ("Error creating the parser.");
+		goto cleanup;
+	}
+
+	rc = dc_parser_set_data (parser, data, size);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR ("Error registering the data.");
+		goto cleanup;
+	}
+
+	rc = dctool_output_write (divedata->output, parser, data, size, fingerprint, fsize);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR ("Error parsing the dive data.");
+		goto cleanup;
+	}
+
+cleanup:
+	// Remember the first failure, but keep downloading the other dives.
+	if (rc != DC_STATUS_SUCCESS && divedata->status == DC_STATUS_SUCCESS)
+		divedata->status = rc;
+	dc_parser_destroy (parser);
+	return 1;
+}
+
+static dc_status_t
+session_timesync (session_t *session, int argc, char *argv[])
+{
+	if (argc != 0)
+		return DC_STATUS_INVALIDARGS;
+
+	dc_datetime_t datetime = {0};
+	dc_ticks_t now = dc_datetime_now ();
+	if (!dc_datetime_localtime (&datetime, now))
+		return DC_STATUS_IO;
+
+	return dc_device_timesync (session->device, &datetime);
+}
+
+static dc_status_t
+session_read (session_t *session, int argc, char *argv[])
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (argc != 3)
+		return DC_STATUS_INVALIDARGS;
+
+	unsigned int address = strtoul (argv[0], NULL, 0);
+	unsigned int count = strtoul (argv[1], NULL, 0);
+
+	dc_buffer_t *buffer = dc_buffer_new (count);
+	if (buffer == NULL || !dc_buffer_resize (buffer, count)) {
+		dc_buffer_free (buffer);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	rc = dc_device_read (session->device, address, dc_buffer_get_data (buffer), dc_buffer_get_size (buffer));
+	if (rc == DC_STATUS_SUCCESS) {
+		dctool_file_write (argv[2], buffer);
+	}
+
+	dc_buffer_free (buffer);
+
+	return rc;
+}
+
+static dc_status_t
+session_dump (session_t *session, int argc, char *argv[])
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (argc != 1)
+		return DC_STATUS_INVALIDARGS;
+
+	dc_buffer_t *buffer = dc_buffer_new (0);
+	if (buffer == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	rc = dc_device_dump (session->device, buffer);
+	if (rc == DC_STATUS_SUCCESS) {
+		dctool_file_write (argv[0], buffer);
+	}
+
+	dc_buffer_free (buffer);
+
+	return rc;
+}
+
+static dc_status_t
+session_download (session_t *session, int argc, char *argv[])
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (argc != 1)
+		return DC_STATUS_INVALIDARGS;
+
+	dctool_output_t *output = dctool_xml_output_new (argv[0], DCTOOL_UNITS_METRIC);
+	if (output == NULL)
+		return DC_STATUS_IO;
+
+	// Only the dives that are newer than the previous download (if any)
+	// are downloaded.
+	rc = dc_device_set_fingerprint (session->device,
+		dc_buffer_get_data (session->fingerprint),
+		dc_buffer_get_size (session->fingerprint));
+	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED)
+		goto cleanup;
+
+	dive_data_t divedata = {0};
+	divedata.device = session->device;
+	divedata.fingerprint = session->fingerprint;
+	divedata.number = 0;
+	divedata.output = output;
+	divedata.status = DC_STATUS_SUCCESS;
+	rc = dc_device_foreach (session->device, dive_cb, &divedata);
+	if (rc == DC_STATUS_SUCCESS)
+		rc = divedata.status;
+
+cleanup:
+	dctool_output_free (output);
+	return rc;
+}
+
+static session_result_t
+session_execute (session_t *session, char *line, FILE *fp)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	// Split the command line into arguments.
+	int argc = 0;
+	char *argv[MAXARGS] = {0};
+	char *token = strtok (line, " \t\r\n");
+	while (token != NULL && argc < MAXARGS) {
+		argv[argc++] = token;
+		token = strtok (NULL, " \t\r\n");
+	}
+
+	// Ignore empty lines.
+	if (argc == 0)
+		return SESSION_CONTINUE;
+
+	if (strcmp (argv[0], "quit") == 0) {
+		fprintf (fp, "OK\n");
+		fflush (fp);
+		return SESSION_QUIT;
+	} else if (strcmp (argv[0], "shutdown") == 0) {
+		fprintf (fp, "OK\n");
+		fflush (fp);
+		return SESSION_SHUTDOWN;
+	} else if (strcmp (argv[0], "timesync") == 0) {
+		rc = session_timesync (session, argc - 1, argv + 1);
+	} else if (strcmp (argv[0], "read") == 0) {
+		rc = session_read (session, argc - 1, argv + 1);
+	} else if (strcmp (argv[0], "dump") == 0) {
+		rc = session_dump (session, argc - 1, argv + 1);
+	} else if (strcmp (argv[0], "download") == 0) {
+		rc = session_download (session, argc - 1, argv + 1);
+	} else {
+		rc = DC_STATUS_UNSUPPORTED;
+	}
+
+	if (rc == DC_STATUS_SUCCESS) {
+		fprintf (fp, "OK\n");
+	} else {
+		fprintf (fp, "ERROR %s\n", dctool_errmsg (rc));
+	}
+	fflush (fp);
+
+	return SESSION_CONTINUE;
+}
+
+static session_result_t
+session_process (session_t *session, FILE *in, FILE *out)
+{
+	session_result_t result = SESSION_CONTINUE;
+	char line[1024];
+
+	while (result == SESSION_CONTINUE && fgets (line, sizeof (line), in) != NULL) {
+		result = session_execute (session, line, out);
+	}
+
+	return result;
+}
+
+#ifndef _WIN32
+static int
+session_listen (session_t *session, const char *path)
+{
+	struct sockaddr_un addr;
+
+	if (strlen (path) >= sizeof (addr.sun_path)) {
+		message ("Socket path too long.\n");
+		return -1;
+	}
+
+	int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		message ("Failed to create the socket.\n");
+		return -1;
+	}
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	strcpy (addr.sun_path, path);
+
+	unlink (path);
+	if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) != 0 ||
+		listen (fd, 1) != 0) {
+		message ("Failed to listen on the socket.\n");
+		close (fd);
+		return -1;
+	}
+
+	// A client disconnecting while a response is being written must not
+	// terminate the daemon. The write fails with EPIPE instead.
+	signal (SIGPIPE, SIG_IGN);
+
+	// The clients are served one after the other. Each client can send
+	// any number of commands, until it disconnects or sends quit.
+	session_result_t result = SESSION_CONTINUE;
+	while (result != SESSION_SHUTDOWN) {
+		int client = accept (fd, NULL, NULL);
+		if (client < 0)
+			break;
+
+		int other = dup (client);
+		FILE *in = fdopen (client, "r");
+		FILE *out = other >= 0 ? fdopen (other, "w") : NULL;
+		if (in && out) {
+			result = session_process (session, in, out);
+		}
+
+		if (out) fclose (out); else if (other >= 0) close (other);
+		if (in) fclose (in); else close (client);
+	}
+
+	close (fd);
+	unlink (path);
+
+	return 0;
+}
+#endif
+
+static int
+dctool_session_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t *descriptor)
+{
+	int exitcode = EXIT_SUCCESS;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	session_t session = {0};
+
+	// Default option values.
+	unsigned int help = 0;
+	const char *socketname = NULL;
+
+	// Parse the command-line options.
+	int opt = 0;
+	const char *optstring = "hs:";
+#ifdef HAVE_GETOPT_LONG
+	struct option options[] = {
+		{"help",        no_argument,       0, 'h'},
+		{"socket",      required_argument, 0, 's'},
+		{0,             0,                 0,  0 }
+	};
+	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
+#else
+	while ((opt = getopt (argc, argv, optstring)) != -1) {
+#endif
+		switch (opt) {
+		case 'h':
+			help = 1;
+			break;
+		case 's':
+			socketname = optarg;
+			break;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	// Show help message.
+	if (help) {
+		dctool_command_showhelp (&dctool_session);
+		return EXIT_SUCCESS;
+	}
+
+#ifdef _WIN32
+	if (socketname) {
+		message ("Sockets are not supported on this platform.\n");
+		return EXIT_FAILURE;
+	}
+#endif
+
+	session.fingerprint = dc_buffer_new (0);
+	if (session.fingerprint == NULL) {
+		message ("Failed to allocate a memory buffer.\n");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	// Open the device. The connection stays open for the entire session,
+	// such that the handshake is only done once for all commands.
+	message ("Opening the device (%s %s, %s).\n",
+		dc_descriptor_get_vendor (descriptor),
+		dc_descriptor_get_product (descriptor),
+		argv[0] ? argv[0] : "null");
+	rc = dc_device_open (&session.device, context, descriptor, argv[0]);
+	if (rc != DC_STATUS_SUCCESS) {
+		message ("ERROR: %s\n", dctool_errmsg (rc));
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	int events = DC_EVENT_WAITING | DC_EVENT_PROGRESS | DC_EVENT_DEVINFO | DC_EVENT_CLOCK | DC_EVENT_VENDOR;
+	dc_device_set_events (session.device, events, dctool_event_cb, NULL);
+	dc_device_set_cancel (session.device, dctool_cancel_cb, NULL);
+
+	// Process the commands.
+#ifndef _WIN32
+	if (socketname) {
+		if (session_listen (&session, socketname) != 0) {
+			exitcode = EXIT_FAILURE;
+		}
+	} else
+#endif
+	{
+		session_process (&session, stdin, stdout);
+	}
+
+cleanup:
+	dc_device_close (session.device);
+	dc_buffer_free (session.fingerprint);
+	return exitcode;
+}
+
+const dctool_command_t dctool_session = {
+	dctool_session_run,
+	DCTOOL_CONFIG_DESCRIPTOR,
+	"session",
+	"Keep the device open and process commands",
+	"Usage:\n"
+	"   dctool session [options] <devname>\n"
+	"\n"
+	"Options:\n"
+#ifdef HAVE_GETOPT_LONG
+	"   -h, --help              Show help message\n"
+	"   -s, --socket <path>     Read the commands from a local socket\n"
+#else
+	"   -h          Show help message\n"
+	"   -s <path>   Read the commands from a local socket\n"
+#endif
+	"\n"
+	"Commands (one per line, from stdin or the socket):\n"
+	"   timesync                         Synchronize the device clock\n"
+	"   read <address> <count> <file>    Read data from the internal memory\n"
+	"   dump <file>                      Download a memory dump\n"
+	"   download <file>                  Download the new dives (xml)\n"
+	"   quit                             End the session (or connection)\n"
+	"   shutdown                         Stop listening on the socket\n"
+	"\n"
+	"Each command is answered with OK or ERROR <message>.\n"
+};
@@ -0,0 +1,461 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <libdivecomputer/buffer.h>
+
+#include "output-private.h"
+#include "columnar.h"
+#include "utils.h"
+
+#define MAXCOLUMNS 64
+
+static dc_status_t dctool_columnar_output_write (dctool_output_t *output, dc_parser_t *parser, const unsigned char data[], unsigned int size, const unsigned char fingerprint[], unsigned int fsize);
+static dc_status_t dctool_columnar_output_free (dctool_output_t *output);
+
+typedef struct column_t {
+	dctool_columnar_id_t id;
+	unsigned int index;
+	dctool_columnar_type_t type;
+	dc_buffer_t *values;
+} column_t;
+
+typedef struct dctool_columnar_output_t {
+	dctool_output_t base;
+	FILE *ostream;
+	unsigned int delta;
+	dc_buffer_t *record;
+	column_t columns[MAXCOLUMNS];
+	unsigned int ncolumns;
+	unsigned int nsamples;
+	unsigned int nppo2;
+	unsigned int nevents;
+} dctool_columnar_output_t;
+
+static const dctool_output_vtable_t columnar_vtable = {
+	sizeof(dctool_columnar_output_t), /* size */
+	dctool_columnar_output_write, /* write */
+	dctool_columnar_output_free, /* free */
+};
+
+static void
+store_uint16 (unsigned char data[], unsigned int value)
+{
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+}
+
+static void
+store_uint32 (unsigned char data[], unsigned int value)
+{
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+}
+
+static unsigned int
+float32_bits (double value)
+{
+	float f = value;
+	unsigned int bits = 0;
+	memcpy (&bits, &f, sizeof (bits));
+	return bits;
+}
+
+static unsigned int
+missing_value (dctool_columnar_type_t type)
+{
+	return type == DCTOOL_COLUMNAR_FLOAT32 ? float32_bits (NAN) : DCTOOL_COLUMNAR_UNDEFINED;
+}
+
+static column_t *
+column_get (dctool_columnar_output_t *output, dctool_columnar_id_t id, unsigned int index, dctool_columnar_type_t type)
+{
+	for (unsigned int i = 0; i < output->ncolumns; ++i) {
+		if (output->columns[i].id == id && output->columns[i].index == index)
+			return output->columns + i;
+	}
+
+	if (output->ncolumns >= MAXCOLUMNS)
+		return NULL;
+
+	column_t *column = output->columns + output->ncolumns;
+	if (column->values == NULL) {
+		column->values = dc_buffer_new (0);
+		if (column->values == NULL)
+			return NULL;
+	}
+
+	column->id = id;
+	column->index = index;
+	column->type = type;
+	dc_buffer_clear (column->values);
+
+	// Backfill the samples that were emitted before this column appeared.
+	if (id < DCTOOL_COLUMNAR_EVENT_TIME) {
+		unsigned int missing = missing_value (type);
+		for (unsigned int i = 0; i < output->nsamples; ++i) {
+			dc_buffer_append (column->values, (const unsigned char *) &missing, sizeof (missing));
+		}
+	}
+
+	output->ncolumns++;
+
+	return column;
+}
+
+static void
+column_set (dctool_columnar_output_t *output, dctool_columnar_id_t id, unsigned int index, dctool_columnar_type_t type, unsigned int value)
+{
+	column_t *column = column_get (output, id, index, type);
+	if (column == NULL || dc_buffer_get_size (column->values) == 0)
+		return;
+
+	// Overwrite the value of the current sample.
+	unsigned char *data = dc_buffer_get_data (column->values);
+	size_t size = dc_buffer_get_size (column->values);
+	memcpy (data + size - sizeof (value), &value, sizeof (value));
+}
+
+static void
+column_append (dctool_columnar_output_t *output, dctool_columnar_id_t id, dctool_columnar_type_t type, unsigned int value)
+{
+	column_t *column = column_get (output, id, 0, type);
+	if (column == NULL)
+		return;
+
+	dc_buffer_append (column->values, (const unsigned char *) &value, sizeof (value));
+}
+
+static void
+sample_begin (dctool_columnar_output_t *output)
+{
+	output->nsamples++;
+	output->nppo2 = 0;
+
+	for (unsigned int i = 0; i < output->ncolumns; ++i) {
+		column_t *column = output->columns + i;
+		if (column->id >= DCTOOL_COLUMNAR_EVENT_TIME)
+			continue;
+
+		unsigned int missing = missing_value (column->type);
+		dc_buffer_append (column->values, (const unsigned char *) &missing, sizeof (missing));
+	}
+}
+
+static void
+sample_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dctool_columnar_output_t *output = (dctool_columnar_output_t *) userdata;
+
+	if (type == DC_SAMPLE_TIME || output->nsamples == 0)
+		sample_begin (output);
+
+	switch (type) {
+	case DC_SAMPLE_TIME:
+		column_set (output, DCTOOL_COLUMNAR_TIME, 0, DCTOOL_COLUMNAR_UINT32, value.time);
+		break;
+	case DC_SAMPLE_DEPTH:
+		column_set (output, DCTOOL_COLUMNAR_DEPTH, 0, DCTOOL_COLUMNAR_FLOAT32, float32_bits (value.depth));
+		break;
+	case DC_SAMPLE_PRESSURE:
+		column_set (output, DCTOOL_COLUMNAR_PRESSURE, value.pressure.tank, DCTOOL_COLUMNAR_FLOAT32, float32_bits (value.pressure.value));
+		break;
+	case DC_SAMPLE_TEMPERATURE:
+		column_set (output, DCTOOL_COLUMNAR_TEMPERATURE, 0, DCTOOL_COLUMNAR_FLOAT32, float32_bits (value.temperature));
+		break;
+	case DC_SAMPLE_EVENT:
+		column_append (output, DCTOOL_COLUMNAR_EVENT_TIME, DCTOOL_COLUMNAR_UINT32, value.event.time);
+		column_append (output, DCTOOL_COLUMNAR_EVENT_TYPE, DCTOOL_COLUMNAR_UINT32, value.event.type);
+		column_append (output, DCTOOL_COLUMNAR_EVENT_FLAGS, DCTOOL_COLUMNAR_UINT32, value.event.flags);
+		column_append (output, DCTOOL_COLUMNAR_EVENT_VALUE, DCTOOL_COLUMNAR_UINT32, value.event.value);
+		output->nevents++;
+		break;
+	case DC_SAMPLE_RBT:
+		column_set (output, DCTOOL_COLUMNAR_RBT, 0, DCTOOL_COLUMNAR_UINT32, value.rbt);
+		break;
+	case DC_SAMPLE_HEARTBEAT:
+		column_set (output, DCTOOL_COLUMNAR_HEARTBEAT, 0, DCTOOL_COLUMNAR_UINT32, value.heartbeat);
+		break;
+	case DC_SAMPLE_BEARING:
+		column_set (output, DCTOOL_COLUMNAR_BEARING, 0, DCTOOL_COLUMNAR_UINT32, value.bearing);
+		break;
+	case DC_SAMPLE_SETPOINT:
+		column_set (output, DCTOOL_COLUMNAR_SETPOINT, 0, DCTOOL_COLUMNAR_FLOAT32, float32_bits (value.setpoint));
+		break;
+	case DC_SAMPLE_PPO2:
+		// Multiple sensor values are stored in separate columns.
+		column_set (output, DCTOOL_COLUMNAR_PPO2, output->nppo2++, DCTOOL_COLUMNAR_FLOAT32, float32_bits (value.ppo2));
+		break;
+	case DC_SAMPLE_CNS:
+		column_set (output, DCTOOL_COLUMNAR_CNS, 0, DCTOOL_COLUMNAR_FLOAT32, float32_bits (value.cns));
+		break;
+	case DC_SAMPLE_DECO:
+		column_set (output, DCTOOL_COLUMNAR_DECO_TYPE, 0, DCTOOL_COLUMNAR_UINT32, value.deco.type);
+		column_set (output, DCTOOL_COLUMNAR_DECO_TIME, 0, DCTOOL_COLUMNAR_UINT32, value.deco.time);
+		column_set (output, DCTOOL_COLUMNAR_DECO_DEPTH, 0, DCTOOL_COLUMNAR_FLOAT32, float32_bits (value.deco.depth));
+		break;
+	case DC_SAMPLE_GASMIX:
+		column_set (output, DCTOOL_COLUMNAR_GASMIX, 0, DCTOOL_COLUMNAR_UINT32, value.gasmix);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+column_encode (dctool_columnar_output_t *output, const column_t *column, unsigned char data[], dctool_columnar_type_t *type, dctool_columnar_encoding_t *encoding)
+{
+	const unsigned char *values = dc_buffer_get_data (column->values);
+	unsigned int count = dc_buffer_get_size (column->values) / 4;
+
+	*type = column->type;
+	*encoding = DCTOOL_COLUMNAR_PLAIN;
+
+	if (output->delta && column->id == DCTOOL_COLUMNAR_TIME) {
+		unsigned int previous = 0;
+		for (unsigned int i = 0; i < count; ++i) {
+			unsigned int value = 0;
+			memcpy (&value, values + i * 4, sizeof (value));
+			if (value == DCTOOL_COLUMNAR_UNDEFINED)
+				value = previous;
+			store_uint32 (data + i * 4, value - previous);
+			previous = value;
+		}
+		*type = DCTOOL_COLUMNAR_INT32;
+		*encoding = DCTOOL_COLUMNAR_DELTA;
+	} else if (output->delta && column->id == DCTOOL_COLUMNAR_DEPTH) {
+		int previous = 0;
+		for (unsigned int i = 0; i < count; ++i) {
+			float value = 0;
+			memcpy (&value, values + i * 4, sizeof (value));
+			int millimeters = previous;
+			if (!isnan (value))
+				millimeters = value >= 0 ? (int) (value * 1000.0 + 0.5) : (int) (value * 1000.0 - 0.5);
+			store_uint32 (data + i * 4, (unsigned int) (millimeters - previous));
+			previous = millimeters;
+		}
+		*type = DCTOOL_COLUMNAR_INT32;
+		*encoding = DCTOOL_COLUMNAR_DELTA;
+	} else {
+		for (unsigned int i = 0; i < count; ++i) {
+			unsigned int value = 0;
+			memcpy (&value, values + i * 4, sizeof (value));
+			store_uint32 (data + i * 4, value);
+		}
+	}
+}
+
+static dc_status_t
+columnar_write_record (dctool_columnar_output_t *output, const dc_datetime_t *dt, unsigned int divetime, double maxdepth, unsigned int divemode, const unsigned char fingerprint[], unsigned int fsize)
+{
+	if (fsize > 255)
+		fsize = 255;
+
+	// Calculate the layout of the record.
+	unsigned int offset = DCTOOL_COLUMNAR_SZ_DIVE + ((fsize + 7) & ~7u) +
+		output->ncolumns * DCTOOL_COLUMNAR_SZ_COLUMN;
+	unsigned int length = offset;
+	for (unsigned int i = 0; i < output->ncolumns; ++i) {
+		length += (dc_buffer_get_size (output->columns[i].values) + 7) & ~7u;
+	}
+
+	if (!dc_buffer_clear (output->record) ||
+		!dc_buffer_resize (output->record, length))
+		return DC_STATUS_NOMEMORY;
+
+	unsigned char *record = dc_buffer_get_data (output->record);
+
+	// Dive header.
+	store_uint32 (record + 0, length);
+	store_uint32 (record + 4, output->base.number);
+	store_uint32 (record + 8, output->nsamples);
+	store_uint32 (record + 12, output->ncolumns);
+	store_uint16 (record + 16, dt->year);
+	record[18] = dt->month;
+	record[19] = dt->day;
+	record[20] = dt->hour;
+	record[21] = dt->minute;
+	record[22] = dt->second;
+	record[23] = fsize;
+	store_uint32 (record + 24, (unsigned int) dt->timezone);
+	store_uint32 (record + 28, divetime);
+	store_uint32 (record + 32, float32_bits (maxdepth));
+	store_uint32 (record + 36, divemode);
+	if (fsize)
+		memcpy (record + DCTOOL_COLUMNAR_SZ_DIVE, fingerprint, fsize);
+
+	// Column directory and data.
+	unsigned char *entry = record + DCTOOL_COLUMNAR_SZ_DIVE + ((fsize + 7) & ~7u);
+	for (unsigned int i = 0; i < output->ncolumns; ++i) {
+		const column_t *column = output->columns + i;
+		unsigned int count = dc_buffer_get_size (column->values) / 4;
+		dctool_columnar_type_t type = column->type;
+		dctool_columnar_encoding_t encoding = DCTOOL_COLUMNAR_PLAIN;
+
+		column_encode (output, column, record + offset, &type, &encoding);
+
+		store_uint16 (entry + 0, column->id);
+		store_uint16 (entry + 2, column->index);
+		entry[4] = type;
+		entry[5] = encoding;
+		store_uint16 (entry + 6, 0);
+		store_uint32 (entry + 8, count);
+		store_uint32 (entry + 12, offset);
+
+		entry += DCTOOL_COLUMNAR_SZ_COLUMN;
+		offset += (count * 4 + 7) & ~7u;
+	}
+
+	if (fwrite (record, 1, length, output->ostream) != length) {
+		ERROR ("Failed to write the dive record.");
+		return DC_STATUS_IO;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+dctool_output_t *
+dctool_columnar_output_new (const char *filename, unsigned int delta)
+{
+	dctool_columnar_output_t *output = NULL;
+
+	if (filename == NULL)
+		goto error_exit;
+
+	// Allocate memory.
+	output = (dctool_columnar_output_t *) dctool_output_allocate (&columnar_vtable);
+	if (output == NULL) {
+		goto error_exit;
+	}
+
+	memset (output->columns, 0, sizeof (output->columns));
+	output->ncolumns = 0;
+	output->nsamples = 0;
+	output->nppo2 = 0;
+	output->nevents = 0;
+	output->delta = delta;
+
+	output->record = dc_buffer_new (0);
+	if (output->record == NULL) {
+		goto error_free;
+	}
+
+	// Open the output file.
+	output->ostream = fopen (filename, "wb");
+	if (output->ostream == NULL) {
+		goto error_free_record;
+	}
+
+	// Write the file header.
+	unsigned char header[DCTOOL_COLUMNAR_SZ_HEADER] = {0};
+	memcpy (header, DCTOOL_COLUMNAR_MAGIC, 4);
+	store_uint16 (header + 4, DCTOOL_COLUMNAR_VERSION);
+	fwrite (header, 1, sizeof (header), output->ostream);
+
+	return (dctool_output_t *) output;
+
+error_free_record:
+	dc_buffer_free (output->record);
+error_free:
+	dctool_output_deallocate ((dctool_output_t *) output);
+error_exit:
+	return NULL;
+}
+
+static dc_status_t
+dctool_columnar_output_write (dctool_output_t *abstract, dc_parser_t *parser, const unsigned char data[], unsigned int size, const unsigned char fingerprint[], unsigned int fsize)
+{
+	dctool_columnar_output_t *output = (dctool_columnar_output_t *) abstract;
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	output->ncolumns = 0;
+	output->nsamples = 0;
+	output->nppo2 = 0;
+	output->nevents = 0;
+
+	// Parse the datetime.
+	dc_datetime_t dt = {0};
+	dt.timezone = DC_TIMEZONE_NONE;
+	status = dc_parser_get_datetime (parser, &dt);
+	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
+		ERROR ("Error parsing the datetime.");
+		return status;
+	}
+
+	// Parse the divetime.
+	unsigned int divetime = 0;
+	status = dc_parser_get_field (parser, DC_FIELD_DIVETIME, 0, &divetime);
+	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
+		ERROR ("Error parsing the divetime.");
+		return status;
+	}
+
+	// Parse the maxdepth.
+	double maxdepth = 0.0;
+	status = dc_parser_get_field (parser, DC_FIELD_MAXDEPTH, 0, &maxdepth);
+	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
+		ERROR ("Error parsing the maxdepth.");
+		return status;
+	}
+
+	// Parse the dive mode.
+	dc_divemode_t divemode = DC_DIVEMODE_OC;
+	status = dc_parser_get_field (parser, DC_FIELD_DIVEMODE, 0, &divemode);
+	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
+		ERROR ("Error parsing the dive mode.");
+		return status;
+	}
+
+	unsigned int mode = DCTOOL_COLUMNAR_UNDEFINED;
+	if (status != DC_STATUS_UNSUPPORTED)
+		mode = divemode;
+
+	// Parse the sample data.
+	status = dc_parser_samples_foreach (parser, sample_cb, output);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR ("Error parsing the sample data.");
+		return status;
+	}
+
+	return columnar_write_record (output, &dt, divetime, maxdepth, mode, fingerprint, fsize);
+}
+
+static dc_status_t
+dctool_columnar_output_free (dctool_output_t *abstract)
+{
+	dctool_columnar_output_t *output = (dctool_columnar_output_t *) abstract;
+
+	for (unsigned int i = 0; i < MAXCOLUMNS; ++i) {
+		dc_buffer_free (output->columns[i].values);
+	}
+
+	dc_buffer_free (output->record);
+
+	fclose (output->ostream);
+
+	return DC_STATUS_SUCCESS;
+}
@@ -19,9 +19,16 @@
  * MA 02110-1301 USA
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 #include <libdivecomputer/datetime.h>
 #include <libdivecomputer/version.h>
@@ -32,6 +39,10 @@ static FILE* g_logfile = NULL;
 
 static unsigned char g_lastchar = '\n';
 
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 #ifdef _WIN32
 	#include <windows.h>
 	static LARGE_INTEGER g_timestamp, g_frequency;
@@ -44,6 +55,10 @@ int message (const char* fmt, ...)
 {
 	va_list ap;
 
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock (&g_mutex);
+#endif
+
 	if (g_logfile) {
 		if (g_lastchar == '\n') {
 #ifdef _WIN32
@@ -76,6 +91,10 @@ int message (const char* fmt, ...)
 	int rc = vfprintf (stderr, fmt, ap);
 	va_end (ap);
 
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock (&g_mutex);
+#endif
+
 	return rc;
 }
 
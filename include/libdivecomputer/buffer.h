@@ -33,6 +33,9 @@ typedef struct dc_buffer_t dc_buffer_t;
 dc_buffer_t *
 dc_buffer_new (size_t capacity);
 
+dc_buffer_t *
+dc_buffer_new_mapped (const char *filename);
+
 void
 dc_buffer_free (dc_buffer_t *buffer);
 
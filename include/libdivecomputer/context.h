@@ -54,6 +54,12 @@ dc_context_free (dc_context_t *context);
 dc_status_t
 dc_context_set_custom_io (dc_context_t *context, dc_custom_io_t *custom_io, dc_user_device_t *);
 
+dc_status_t
+dc_context_set_capture (dc_context_t *context, const char *filename);
+
+dc_status_t
+dc_context_set_replay (dc_context_t *context, const char *filename, double speed);
+
 dc_status_t
 dc_context_set_loglevel (dc_context_t *context, dc_loglevel_t loglevel);
 
@@ -43,6 +43,12 @@ typedef struct dc_descriptor_t dc_descriptor_t;
 dc_status_t
 dc_descriptor_iterator (dc_iterator_t **iterator);
 
+dc_status_t
+dc_descriptor_find (dc_descriptor_t **descriptor, dc_family_t family, unsigned int model);
+
+dc_status_t
+dc_descriptor_find_usb (dc_descriptor_t **descriptor, unsigned int vid, unsigned int pid);
+
 void
 dc_descriptor_free (dc_descriptor_t *descriptor);
 
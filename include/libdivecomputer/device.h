@@ -63,6 +63,22 @@ typedef struct dc_event_vendor_t {
 	unsigned int size;
 } dc_event_vendor_t;
 
+typedef struct dc_statistics_t {
+	size_t nbytes_read;
+	size_t nbytes_written;
+	unsigned int nreads;
+	unsigned int nwrites;
+	unsigned int nroundtrips;
+	unsigned int nretries;
+	unsigned int ntimeouts;
+	double read_time;     /* Seconds */
+	double sleep_time;    /* Seconds */
+	double callback_time; /* Seconds */
+	double rtt;           /* Seconds */
+	double rtt_variation; /* Seconds */
+	double timeout;       /* Seconds */
+} dc_statistics_t;
+
 typedef int (*dc_cancel_callback_t) (void *userdata);
 
 typedef void (*dc_event_callback_t) (dc_device_t *device, dc_event_type_t event, const void *data, void *userdata);
@@ -84,6 +100,9 @@ dc_device_set_events (dc_device_t *device, unsigned int events, dc_event_callbac
 dc_status_t
 dc_device_set_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size);
 
+dc_status_t
+dc_device_set_cache (dc_device_t *device, const unsigned char data[], unsigned int size);
+
 dc_status_t
 dc_device_read (dc_device_t *device, unsigned int address, unsigned char data[], unsigned int size);
 
@@ -99,6 +118,9 @@ dc_device_foreach (dc_device_t *device, dc_dive_callback_t callback, void *userd
 dc_status_t
 dc_device_timesync (dc_device_t *device, const dc_datetime_t *datetime);
 
+dc_status_t
+dc_device_get_statistics (dc_device_t *device, dc_statistics_t *statistics);
+
 dc_status_t
 dc_device_close (dc_device_t *device);
 
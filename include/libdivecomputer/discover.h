@@ -0,0 +1,53 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_DISCOVER_H
+#define DC_DISCOVER_H
+
+#include "common.h"
+#include "context.h"
+#include "descriptor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Discovery callback. The descriptor is NULL if the device could not
+ * be identified (e.g. serial ports). The name is the transport specific
+ * identifier to open the device with (a device node, IrDA name or
+ * bluetooth address), or NULL if there is none.
+ */
+typedef void (*dc_discover_callback_t) (dc_transport_t transport, dc_descriptor_t *descriptor, const char *name, void *userdata);
+
+/**
+ * Scan all transports for supported devices. The transports are scanned
+ * concurrently where possible, and each match is reported as soon as it
+ * is found. The callback is never invoked concurrently. If a descriptor
+ * is passed, only devices matching that descriptor are reported.
+ */
+dc_status_t
+dc_discover (dc_context_t *context, dc_descriptor_t *descriptor, dc_discover_callback_t callback, void *userdata);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_DISCOVER_H */
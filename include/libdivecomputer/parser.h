@@ -49,6 +49,9 @@ typedef enum dc_sample_type_t {
 	DC_SAMPLE_GASMIX
 } dc_sample_type_t;
 
+#define DC_SAMPLE_MASK(type) (1u << (type))
+#define DC_SAMPLE_MASK_ALL   (~0u)
+
 typedef enum dc_field_type_t {
 	DC_FIELD_DIVETIME,
 	DC_FIELD_MAXDEPTH,
@@ -264,9 +267,21 @@ dc_parser_get_datetime (dc_parser_t *parser, dc_datetime_t *datetime);
 dc_status_t
 dc_parser_get_field (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, void *value);
 
+dc_status_t
+dc_parser_set_sample_mask (dc_parser_t *parser, unsigned int mask);
+
+dc_status_t
+dc_parser_set_decimation (dc_parser_t *parser, unsigned int interval);
+
+dc_status_t
+dc_parser_set_index (dc_parser_t *parser, unsigned int spacing);
+
 dc_status_t
 dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata);
 
+dc_status_t
+dc_parser_samples_range (dc_parser_t *parser, unsigned int begin, unsigned int end, dc_sample_callback_t callback, void *userdata);
+
 dc_status_t
 dc_parser_destroy (dc_parser_t *parser);
 
@@ -49,6 +49,9 @@ array_convert_bin2hex (const unsigned char input[], unsigned int isize, unsigned
 int
 array_convert_hex2bin (const unsigned char input[], unsigned int isize, unsigned char output[], unsigned int osize);
 
+int
+array_convert_hex2bin_add (const unsigned char input[], unsigned int isize, unsigned char output[], unsigned int osize, unsigned char *checksum);
+
 unsigned int
 array_convert_str2num (const unsigned char data[], unsigned int size);
 
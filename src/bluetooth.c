@@ -25,6 +25,9 @@
 
 #include <stdlib.h> // malloc, free
 #include <stdio.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 #include "socket.h"
 
@@ -65,6 +68,8 @@
 #define MAX_DEVICES 255
 #define MAX_PERIODS 8
 
+#define SDP_CACHE_SIZE 8
+
 #define ISINSTANCE(device) dc_iostream_isinstance((device), &dc_bluetooth_vtable)
 
 struct dc_bluetooth_device_t {
@@ -114,6 +119,73 @@ static const dc_iostream_vtable_t dc_bluetooth_vtable = {
 };
 
 #ifdef HAVE_BLUEZ
+typedef struct dc_sdp_cache_t {
+	dc_bluetooth_address_t address;
+	uint8_t port;
+} dc_sdp_cache_t;
+
+// The rfcomm port numbers of the most recently used devices. This avoids
+// the slow SDP query each time the same device is opened again.
+static dc_sdp_cache_t g_sdp_cache[SDP_CACHE_SIZE];
+static size_t g_sdp_cache_next = 0;
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t g_sdp_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static uint8_t
+dc_sdp_cache_get (dc_bluetooth_address_t address)
+{
+	uint8_t port = 0;
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock (&g_sdp_cache_mutex);
+#endif
+
+	for (size_t i = 0; i < C_ARRAY_SIZE(g_sdp_cache); ++i) {
+		if (g_sdp_cache[i].port && g_sdp_cache[i].address == address) {
+			port = g_sdp_cache[i].port;
+			break;
+		}
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock (&g_sdp_cache_mutex);
+#endif
+
+	return port;
+}
+
+static void
+dc_sdp_cache_set (dc_bluetooth_address_t address, uint8_t port)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock (&g_sdp_cache_mutex);
+#endif
+
+	// Find the existing entry for the device.
+	size_t i = 0;
+	while (i < C_ARRAY_SIZE(g_sdp_cache)) {
+		if (g_sdp_cache[i].port && g_sdp_cache[i].address == address)
+			break;
+		i++;
+	}
+
+	if (i < C_ARRAY_SIZE(g_sdp_cache)) {
+		// Update (or remove) the existing entry.
+		g_sdp_cache[i].port = port;
+	} else if (port) {
+		// Replace the oldest entry.
+		i = g_sdp_cache_next;
+		g_sdp_cache[i].address = address;
+		g_sdp_cache[i].port = port;
+		g_sdp_cache_next = (i + 1) % C_ARRAY_SIZE(g_sdp_cache);
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock (&g_sdp_cache_mutex);
+#endif
+}
+
 static dc_bluetooth_address_t
 dc_address_get (const bdaddr_t *ba)
 {
@@ -493,6 +565,11 @@ dc_bluetooth_iterator_free (dc_iterator_t *abstract)
 dc_status_t
 dc_bluetooth_open (dc_iostream_t **out, dc_context_t *context, dc_bluetooth_address_t address, unsigned int port)
 {
+	// Are we replaying a capture file?
+	dc_capture_t *capture = _dc_context_capture (context);
+	if (dc_capture_isreplay (capture))
+		return dc_capture_open (out, context, capture);
+
 #ifdef BLUETOOTH
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_socket_t *device = NULL;
@@ -534,9 +611,13 @@ dc_bluetooth_open (dc_iostream_t **out, dc_context_t *context, dc_bluetooth_addr
 	sa.rc_family = AF_BLUETOOTH;
 	dc_address_set (&sa.rc_bdaddr, address);
 	if (port == 0) {
-		status = dc_bluetooth_sdp (&sa.rc_channel, context, &sa.rc_bdaddr);
-		if (status != DC_STATUS_SUCCESS) {
-			goto error_close;
+		sa.rc_channel = dc_sdp_cache_get (address);
+		if (sa.rc_channel == 0) {
+			status = dc_bluetooth_sdp (&sa.rc_channel, context, &sa.rc_bdaddr);
+			if (status != DC_STATUS_SUCCESS) {
+				goto error_close;
+			}
+			dc_sdp_cache_set (address, sa.rc_channel);
 		}
 	} else {
 		sa.rc_channel = port;
@@ -545,6 +626,12 @@ dc_bluetooth_open (dc_iostream_t **out, dc_context_t *context, dc_bluetooth_addr
 
 	status = dc_socket_connect (&device->base, (struct sockaddr *) &sa, sizeof (sa));
 	if (status != DC_STATUS_SUCCESS) {
+#ifndef _WIN32
+		// The cached port number may be outdated.
+		if (port == 0) {
+			dc_sdp_cache_set (address, 0);
+		}
+#endif
 		goto error_close;
 	}
 
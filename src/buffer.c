@@ -19,16 +19,53 @@
  * MA 02110-1301 USA
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <stdlib.h> // malloc, realloc, free
 #include <string.h> // memcpy, memmove
 
+#ifdef _WIN32
+#define NOGDI
+#include <windows.h>
+#elif defined(HAVE_SYS_MMAN_H)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define HAVE_MMAP_BUFFER
+#endif
+
 #include <libdivecomputer/buffer.h>
 
 struct dc_buffer_t {
 	unsigned char *data;
 	size_t capacity, offset, size;
+	int mapped;
 };
 
+static void
+dc_buffer_release (dc_buffer_t *buffer)
+{
+	if (buffer->data == NULL)
+		return;
+
+	if (buffer->mapped) {
+#if defined(_WIN32)
+		UnmapViewOfFile (buffer->data);
+#elif defined(HAVE_MMAP_BUFFER)
+		munmap (buffer->data, buffer->capacity);
+#endif
+	} else {
+		free (buffer->data);
+	}
+
+	buffer->data = NULL;
+	buffer->mapped = 0;
+}
+
 dc_buffer_t *
 dc_buffer_new (size_t capacity)
 {
@@ -49,6 +86,95 @@ dc_buffer_new (size_t capacity)
 	buffer->capacity = capacity;
 	buffer->offset = 0;
 	buffer->size = 0;
+	buffer->mapped = 0;
+
+	return buffer;
+}
+
+
+dc_buffer_t *
+dc_buffer_new_mapped (const char *filename)
+{
+	unsigned char *data = NULL;
+	size_t size = 0;
+
+	if (filename == NULL)
+		return NULL;
+
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA (filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	LARGE_INTEGER filesize;
+	if (!GetFileSizeEx (hFile, &filesize) || (ULONGLONG) filesize.QuadPart > (size_t) -1) {
+		CloseHandle (hFile);
+		return NULL;
+	}
+
+	size = (size_t) filesize.QuadPart;
+	if (size) {
+		// A copy-on-write view keeps the buffer writable for the caller,
+		// without ever modifying the underlying file.
+		HANDLE hMapping = CreateFileMappingA (hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		if (hMapping == NULL) {
+			CloseHandle (hFile);
+			return NULL;
+		}
+
+		data = (unsigned char *) MapViewOfFile (hMapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle (hMapping);
+		if (data == NULL) {
+			CloseHandle (hFile);
+			return NULL;
+		}
+	}
+
+	CloseHandle (hFile);
+#elif defined(HAVE_MMAP_BUFFER)
+	int fd = open (filename, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+
+	struct stat st;
+	if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || (unsigned long long) st.st_size > (size_t) -1) {
+		close (fd);
+		return NULL;
+	}
+
+	size = (size_t) st.st_size;
+	if (size) {
+		// A private mapping keeps the buffer writable for the caller,
+		// without ever modifying the underlying file.
+		void *mapping = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED) {
+			close (fd);
+			return NULL;
+		}
+
+		data = (unsigned char *) mapping;
+	}
+
+	close (fd);
+#else
+	return NULL;
+#endif
+
+	dc_buffer_t *buffer = (dc_buffer_t *) malloc (sizeof (dc_buffer_t));
+	if (buffer == NULL) {
+#if defined(_WIN32)
+		if (data) UnmapViewOfFile (data);
+#elif defined(HAVE_MMAP_BUFFER)
+		if (data) munmap (data, size);
+#endif
+		return NULL;
+	}
+
+	buffer->data = data;
+	buffer->capacity = size;
+	buffer->offset = 0;
+	buffer->size = size;
+	buffer->mapped = (data != NULL);
 
 	return buffer;
 }
@@ -60,8 +186,7 @@ dc_buffer_free (dc_buffer_t *buffer)
 	if (buffer == NULL)
 		return;
 
-	if (buffer->data)
-		free (buffer->data);
+	dc_buffer_release (buffer);
 
 	free (buffer);
 }
@@ -106,7 +231,7 @@ dc_buffer_expand_append (dc_buffer_t *buffer, size_t n)
 			if (buffer->size)
 				memcpy (data, buffer->data + buffer->offset, buffer->size);
 
-			free (buffer->data);
+			dc_buffer_release (buffer);
 
 			buffer->data = data;
 			buffer->capacity = capacity;
@@ -139,7 +264,7 @@ dc_buffer_expand_prepend (dc_buffer_t *buffer, size_t n)
 			if (buffer->size)
 				memcpy (data + capacity - buffer->size, buffer->data + buffer->offset, buffer->size);
 
-			free (buffer->data);
+			dc_buffer_release (buffer);
 
 			buffer->data = data;
 			buffer->capacity = capacity;
@@ -165,9 +290,22 @@ dc_buffer_reserve (dc_buffer_t *buffer, size_t capacity)
 	if (capacity <= buffer->capacity)
 		return 1;
 
-	unsigned char *data = (unsigned char *) realloc (buffer->data, capacity);
-	if (data == NULL)
-		return 0;
+	unsigned char *data = NULL;
+	if (buffer->mapped) {
+		// A mapped buffer can't grow in place. Move the contents to the heap.
+		data = (unsigned char *) malloc (capacity);
+		if (data == NULL)
+			return 0;
+
+		if (buffer->size)
+			memcpy (data + buffer->offset, buffer->data + buffer->offset, buffer->size);
+
+		dc_buffer_release (buffer);
+	} else {
+		data = (unsigned char *) realloc (buffer->data, capacity);
+		if (data == NULL)
+			return 0;
+	}
 
 	buffer->data = data;
 	buffer->capacity = capacity;
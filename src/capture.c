@@ -0,0 +1,518 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define NOGDI
+#include <windows.h>
+#else
+#include <time.h>
+#include <errno.h>
+#endif
+
+#include <libdivecomputer/buffer.h>
+
+#include "capture.h"
+#include "timer.h"
+#include "array.h"
+#include "iostream-private.h"
+#include "context-private.h"
+
+#define MAGIC   "DCIO"
+#define FORMAT  1
+
+#define SZ_HEADER 8
+#define SZ_RECORD 10
+
+static dc_status_t dc_capture_set_timeout (dc_iostream_t *abstract, int timeout);
+static dc_status_t dc_capture_set_latency (dc_iostream_t *abstract, unsigned int value);
+static dc_status_t dc_capture_set_break (dc_iostream_t *abstract, unsigned int value);
+static dc_status_t dc_capture_set_dtr (dc_iostream_t *abstract, unsigned int value);
+static dc_status_t dc_capture_set_rts (dc_iostream_t *abstract, unsigned int value);
+static dc_status_t dc_capture_get_lines (dc_iostream_t *abstract, unsigned int *value);
+static dc_status_t dc_capture_get_available (dc_iostream_t *abstract, size_t *value);
+static dc_status_t dc_capture_configure (dc_iostream_t *abstract, unsigned int baudrate, unsigned int databits, dc_parity_t parity, dc_stopbits_t stopbits, dc_flowcontrol_t flowcontrol);
+static dc_status_t dc_capture_read (dc_iostream_t *abstract, void *data, size_t size, size_t *actual);
+static dc_status_t dc_capture_write (dc_iostream_t *abstract, const void *data, size_t size, size_t *actual);
+static dc_status_t dc_capture_flush (dc_iostream_t *abstract);
+static dc_status_t dc_capture_purge (dc_iostream_t *abstract, dc_direction_t direction);
+static dc_status_t dc_capture_sleep (dc_iostream_t *abstract, unsigned int milliseconds);
+static dc_status_t dc_capture_close (dc_iostream_t *abstract);
+
+struct dc_capture_t {
+	dc_context_t *context;
+	dc_capture_mode_t mode;
+	FILE *fp;
+	dc_timer_t *timer;
+	// Timestamp of the previous record (record mode).
+	dc_usecs_t previous;
+	// Replay timing (replay mode).
+	double speed;
+	dc_usecs_t start;
+	dc_usecs_t elapsed;
+	unsigned int count;
+	// Data of the current record (replay mode).
+	dc_buffer_t *buffer;
+};
+
+typedef struct dc_replay_t {
+	/* Base class. */
+	dc_iostream_t base;
+	/* Internal state. */
+	dc_capture_t *capture;
+} dc_replay_t;
+
+static const dc_iostream_vtable_t dc_capture_vtable = {
+	sizeof(dc_replay_t),
+	dc_capture_set_timeout, /* set_timeout */
+	dc_capture_set_latency, /* set_latency */
+	dc_capture_set_break, /* set_break */
+	dc_capture_set_dtr, /* set_dtr */
+	dc_capture_set_rts, /* set_rts */
+	dc_capture_get_lines, /* get_lines */
+	dc_capture_get_available, /* get_received */
+	dc_capture_configure, /* configure */
+	dc_capture_read, /* read */
+	dc_capture_write, /* write */
+	dc_capture_flush, /* flush */
+	dc_capture_purge, /* purge */
+	dc_capture_sleep, /* sleep */
+	dc_capture_close, /* close */
+};
+
+static void
+dc_capture_usleep (dc_usecs_t usecs)
+{
+#ifdef _WIN32
+	Sleep ((DWORD) (usecs / 1000));
+#else
+	struct timespec ts;
+	ts.tv_sec  = (usecs / 1000000);
+	ts.tv_nsec = (usecs % 1000000) * 1000;
+
+	while (nanosleep (&ts, &ts) != 0) {
+		if (errno != EINTR)
+			break;
+	}
+#endif
+}
+
+dc_status_t
+dc_capture_new (dc_capture_t **out, dc_context_t *context, const char *filename, dc_capture_mode_t mode, double speed)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_capture_t *capture = NULL;
+	unsigned char header[SZ_HEADER] = {0};
+
+	if (out == NULL || filename == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (mode != DC_CAPTURE_RECORD && mode != DC_CAPTURE_REPLAY)
+		return DC_STATUS_INVALIDARGS;
+
+	// Allocate memory.
+	capture = (dc_capture_t *) malloc (sizeof (dc_capture_t));
+	if (capture == NULL) {
+		ERROR (context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	capture->context = context;
+	capture->mode = mode;
+	capture->fp = NULL;
+	capture->timer = NULL;
+	capture->previous = 0;
+	capture->speed = speed;
+	capture->start = 0;
+	capture->elapsed = 0;
+	capture->count = 0;
+	capture->buffer = NULL;
+
+	status = dc_timer_new (&capture->timer);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (context, "Failed to create a high resolution timer.");
+		goto error_free;
+	}
+
+	capture->buffer = dc_buffer_new (0);
+	if (capture->buffer == NULL) {
+		ERROR (context, "Failed to allocate memory.");
+		status = DC_STATUS_NOMEMORY;
+		goto error_timer_free;
+	}
+
+	capture->fp = fopen (filename, mode == DC_CAPTURE_RECORD ? "wb" : "rb");
+	if (capture->fp == NULL) {
+		ERROR (context, "Failed to open the capture file (%s).", filename);
+		status = DC_STATUS_IO;
+		goto error_buffer_free;
+	}
+
+	if (mode == DC_CAPTURE_RECORD) {
+		// Write the file header.
+		memcpy (header, MAGIC, 4);
+		array_uint32_le_set (header + 4, FORMAT);
+		if (fwrite (header, sizeof (header), 1, capture->fp) != 1) {
+			ERROR (context, "Failed to write the capture file header.");
+			status = DC_STATUS_IO;
+			goto error_fclose;
+		}
+
+		dc_timer_now (capture->timer, &capture->previous);
+	} else {
+		// Verify the file header.
+		if (fread (header, sizeof (header), 1, capture->fp) != 1 ||
+			memcmp (header, MAGIC, 4) != 0 ||
+			array_uint32_le (header + 4) != FORMAT) {
+			ERROR (context, "Invalid capture file header.");
+			status = DC_STATUS_DATAFORMAT;
+			goto error_fclose;
+		}
+	}
+
+	INFO (context, "Capture: file=%s, mode=%s", filename,
+		mode == DC_CAPTURE_RECORD ? "record" : "replay");
+
+	*out = capture;
+
+	return DC_STATUS_SUCCESS;
+
+error_fclose:
+	fclose (capture->fp);
+error_buffer_free:
+	dc_buffer_free (capture->buffer);
+error_timer_free:
+	dc_timer_free (capture->timer);
+error_free:
+	free (capture);
+	return status;
+}
+
+dc_status_t
+dc_capture_free (dc_capture_t *capture)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (capture == NULL)
+		return DC_STATUS_SUCCESS;
+
+	if (fclose (capture->fp) != 0) {
+		ERROR (capture->context, "Failed to close the capture file.");
+		status = DC_STATUS_IO;
+	}
+
+	dc_buffer_free (capture->buffer);
+	dc_timer_free (capture->timer);
+	free (capture);
+
+	return status;
+}
+
+void
+dc_capture_record (dc_capture_t *capture, dc_capture_type_t type, dc_status_t status, const void *data, size_t size)
+{
+	if (capture == NULL || capture->mode != DC_CAPTURE_RECORD)
+		return;
+
+	// Get the time since the previous record.
+	dc_usecs_t now = 0, delta = 0;
+	if (dc_timer_now (capture->timer, &now) == DC_STATUS_SUCCESS) {
+		delta = now - capture->previous;
+		if (delta > 0xFFFFFFFF)
+			delta = 0xFFFFFFFF;
+		capture->previous = now;
+	}
+
+	unsigned char header[SZ_RECORD] = {0};
+	header[0] = type;
+	header[1] = (signed char) status;
+	array_uint32_le_set (header + 2, (unsigned int) delta);
+	array_uint32_le_set (header + 6, size);
+
+	if (fwrite (header, sizeof (header), 1, capture->fp) != 1 ||
+		(size && fwrite (data, size, 1, capture->fp) != 1)) {
+		ERROR (capture->context, "Failed to write the capture record.");
+	}
+}
+
+static dc_status_t
+dc_capture_next (dc_capture_t *capture, dc_capture_type_t type, dc_status_t *status)
+{
+	unsigned char header[SZ_RECORD] = {0};
+	if (fread (header, sizeof (header), 1, capture->fp) != 1) {
+		ERROR (capture->context, "Unexpected end of the capture file.");
+		return DC_STATUS_IO;
+	}
+
+	unsigned int delta = array_uint32_le (header + 2);
+	unsigned int size = array_uint32_le (header + 6);
+
+	if (!dc_buffer_resize (capture->buffer, size)) {
+		ERROR (capture->context, "Insufficient buffer space available.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	if (size && fread (dc_buffer_get_data (capture->buffer), size, 1, capture->fp) != 1) {
+		ERROR (capture->context, "Unexpected end of the capture file.");
+		return DC_STATUS_IO;
+	}
+
+	// The calls of the driver must match the recorded calls exactly.
+	if (header[0] != type) {
+		ERROR (capture->context, "Unexpected call in record %u (%u instead of %u).",
+			capture->count, type, header[0]);
+		return DC_STATUS_IO;
+	}
+
+	// Wait until the original completion time of the call, scaled with
+	// the replay speed. The time before the first call is not replayed.
+	dc_usecs_t now = 0;
+	dc_timer_now (capture->timer, &now);
+	if (capture->count == 0) {
+		capture->start = now;
+	} else {
+		capture->elapsed += delta;
+	}
+	if (capture->speed > 0) {
+		dc_usecs_t target = capture->start + (dc_usecs_t) (capture->elapsed / capture->speed);
+		if (target > now)
+			dc_capture_usleep (target - now);
+	}
+
+	capture->count++;
+
+	*status = (signed char) header[1];
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_capture_next_value (dc_capture_t *capture, dc_capture_type_t type, dc_status_t *status, unsigned int *value)
+{
+	dc_status_t rc = dc_capture_next (capture, type, status);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	if (dc_buffer_get_size (capture->buffer) != 4) {
+		ERROR (capture->context, "Unexpected record size.");
+		return DC_STATUS_DATAFORMAT;
+	}
+
+	if (value)
+		*value = array_uint32_le (dc_buffer_get_data (capture->buffer));
+
+	return DC_STATUS_SUCCESS;
+}
+
+int
+dc_capture_isreplay (dc_capture_t *capture)
+{
+	return capture != NULL && capture->mode == DC_CAPTURE_REPLAY;
+}
+
+dc_status_t
+dc_capture_open (dc_iostream_t **out, dc_context_t *context, dc_capture_t *capture)
+{
+	dc_replay_t *replay = NULL;
+
+	if (out == NULL || capture == NULL || capture->mode != DC_CAPTURE_REPLAY)
+		return DC_STATUS_INVALIDARGS;
+
+	INFO (context, "Open: replay");
+
+	// Allocate memory.
+	replay = (dc_replay_t *) dc_iostream_allocate (context, &dc_capture_vtable);
+	if (replay == NULL) {
+		ERROR (context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	replay->capture = capture;
+
+	*out = (dc_iostream_t *) replay;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_capture_replay_value (dc_iostream_t *abstract, dc_capture_type_t type, unsigned int *value)
+{
+	dc_replay_t *replay = (dc_replay_t *) abstract;
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	dc_status_t rc = dc_capture_next_value (replay->capture, type, &status, value);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	return status;
+}
+
+static dc_status_t
+dc_capture_set_timeout (dc_iostream_t *abstract, int timeout)
+{
+	return dc_capture_replay_value (abstract, DC_CAPTURE_SET_TIMEOUT, NULL);
+}
+
+static dc_status_t
+dc_capture_set_latency (dc_iostream_t *abstract, unsigned int value)
+{
+	return dc_capture_replay_value (abstract, DC_CAPTURE_SET_LATENCY, NULL);
+}
+
+static dc_status_t
+dc_capture_set_break (dc_iostream_t *abstract, unsigned int value)
+{
+	return dc_capture_replay_value (abstract, DC_CAPTURE_SET_BREAK, NULL);
+}
+
+static dc_status_t
+dc_capture_set_dtr (dc_iostream_t *abstract, unsigned int value)
+{
+	return dc_capture_replay_value (abstract, DC_CAPTURE_SET_DTR, NULL);
+}
+
+static dc_status_t
+dc_capture_set_rts (dc_iostream_t *abstract, unsigned int value)
+{
+	return dc_capture_replay_value (abstract, DC_CAPTURE_SET_RTS, NULL);
+}
+
+static dc_status_t
+dc_capture_get_lines (dc_iostream_t *abstract, unsigned int *value)
+{
+	return dc_capture_replay_value (abstract, DC_CAPTURE_GET_LINES, value);
+}
+
+static dc_status_t
+dc_capture_get_available (dc_iostream_t *abstract, size_t *value)
+{
+	unsigned int available = 0;
+	dc_status_t status = dc_capture_replay_value (abstract, DC_CAPTURE_GET_AVAILABLE, &available);
+	if (value)
+		*value = available;
+
+	return status;
+}
+
+static dc_status_t
+dc_capture_configure (dc_iostream_t *abstract, unsigned int baudrate, unsigned int databits, dc_parity_t parity, dc_stopbits_t stopbits, dc_flowcontrol_t flowcontrol)
+{
+	dc_replay_t *replay = (dc_replay_t *) abstract;
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	dc_status_t rc = dc_capture_next (replay->capture, DC_CAPTURE_CONFIGURE, &status);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	return status;
+}
+
+static dc_status_t
+dc_capture_read (dc_iostream_t *abstract, void *data, size_t size, size_t *actual)
+{
+	dc_replay_t *replay = (dc_replay_t *) abstract;
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	dc_status_t rc = dc_capture_next (replay->capture, DC_CAPTURE_READ, &status);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	size_t nbytes = dc_buffer_get_size (replay->capture->buffer);
+	if (nbytes > size) {
+		WARNING (abstract->context, "Recorded read truncated (%u of %u bytes).",
+			(unsigned int) size, (unsigned int) nbytes);
+		nbytes = size;
+	}
+
+	memcpy (data, dc_buffer_get_data (replay->capture->buffer), nbytes);
+
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+static dc_status_t
+dc_capture_write (dc_iostream_t *abstract, const void *data, size_t size, size_t *actual)
+{
+	dc_replay_t *replay = (dc_replay_t *) abstract;
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	dc_status_t rc = dc_capture_next (replay->capture, DC_CAPTURE_WRITE, &status);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	size_t nbytes = dc_buffer_get_size (replay->capture->buffer);
+	if (nbytes != size || memcmp (data, dc_buffer_get_data (replay->capture->buffer), size) != 0) {
+		WARNING (abstract->context, "Written data does not match the recorded data.");
+	}
+
+	if (actual)
+		*actual = (nbytes < size ? nbytes : size);
+
+	return status;
+}
+
+static dc_status_t
+dc_capture_flush (dc_iostream_t *abstract)
+{
+	dc_replay_t *replay = (dc_replay_t *) abstract;
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	dc_status_t rc = dc_capture_next (replay->capture, DC_CAPTURE_FLUSH, &status);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	return status;
+}
+
+static dc_status_t
+dc_capture_purge (dc_iostream_t *abstract, dc_direction_t direction)
+{
+	return dc_capture_replay_value (abstract, DC_CAPTURE_PURGE, NULL);
+}
+
+static dc_status_t
+dc_capture_sleep (dc_iostream_t *abstract, unsigned int milliseconds)
+{
+	return dc_capture_replay_value (abstract, DC_CAPTURE_SLEEP, NULL);
+}
+
+static dc_status_t
+dc_capture_close (dc_iostream_t *abstract)
+{
+	dc_replay_t *replay = (dc_replay_t *) abstract;
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	// A capture that was recorded without closing the
+	// I/O stream is not considered an error.
+	if (dc_capture_next (replay->capture, DC_CAPTURE_CLOSE, &status) != DC_STATUS_SUCCESS)
+		return DC_STATUS_SUCCESS;
+
+	return status;
+}
@@ -0,0 +1,128 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_CAPTURE_H
+#define DC_CAPTURE_H
+
+#include <libdivecomputer/common.h>
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/iostream.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Opaque object representing an I/O capture file.
+ *
+ * A capture file contains one record for every call on an I/O stream,
+ * in the order the calls were made. Each record stores the type of the
+ * call, the returned status, the completion time and the data that was
+ * transferred (or the argument value for the control calls).
+ */
+typedef struct dc_capture_t dc_capture_t;
+
+typedef enum dc_capture_mode_t {
+	DC_CAPTURE_RECORD,
+	DC_CAPTURE_REPLAY
+} dc_capture_mode_t;
+
+typedef enum dc_capture_type_t {
+	DC_CAPTURE_SET_TIMEOUT = 1,
+	DC_CAPTURE_SET_LATENCY,
+	DC_CAPTURE_SET_BREAK,
+	DC_CAPTURE_SET_DTR,
+	DC_CAPTURE_SET_RTS,
+	DC_CAPTURE_GET_LINES,
+	DC_CAPTURE_GET_AVAILABLE,
+	DC_CAPTURE_CONFIGURE,
+	DC_CAPTURE_READ,
+	DC_CAPTURE_WRITE,
+	DC_CAPTURE_FLUSH,
+	DC_CAPTURE_PURGE,
+	DC_CAPTURE_SLEEP,
+	DC_CAPTURE_CLOSE
+} dc_capture_type_t;
+
+/**
+ * Open a capture file.
+ *
+ * @param[out]  capture   A location to store the capture object.
+ * @param[in]   context   A valid context object.
+ * @param[in]   filename  The name of the capture file.
+ * @param[in]   mode      Record a new file, or replay an existing one.
+ * @param[in]   speed     The replay speed. A value of 1.0 reproduces the
+ *                        original timing, larger values replay faster, and
+ *                        zero replays without any delays.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_capture_new (dc_capture_t **capture, dc_context_t *context, const char *filename, dc_capture_mode_t mode, double speed);
+
+/**
+ * Append a record to a capture file in record mode. In replay mode,
+ * the call is ignored.
+ *
+ * @param[in]  capture  A valid capture object.
+ * @param[in]  type     The type of the call.
+ * @param[in]  status   The status returned by the call.
+ * @param[in]  data     The data or argument values of the call.
+ * @param[in]  size     The size of the data.
+ */
+void
+dc_capture_record (dc_capture_t *capture, dc_capture_type_t type, dc_status_t status, const void *data, size_t size);
+
+/**
+ * Check whether a capture file is in replay mode.
+ *
+ * @param[in]  capture  A capture object, or NULL.
+ * @returns Non-zero in replay mode, zero otherwise.
+ */
+int
+dc_capture_isreplay (dc_capture_t *capture);
+
+/**
+ * Create an I/O stream that replays the calls from a capture file.
+ *
+ * @param[out]  iostream  A location to store the replay I/O stream.
+ * @param[in]   context   A valid context object.
+ * @param[in]   capture   A capture object in replay mode.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_capture_open (dc_iostream_t **iostream, dc_context_t *context, dc_capture_t *capture);
+
+/**
+ * Close the capture file and free all resources.
+ *
+ * @param[in]  capture  A valid capture object.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_capture_free (dc_capture_t *capture);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_CAPTURE_H */
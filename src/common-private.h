@@ -23,6 +23,8 @@
 #define COMMON_PRIVATE_H
 
 #include <libdivecomputer/common.h>
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/buffer.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,6 +33,9 @@ extern "C" {
 void
 dc_status_set_error (dc_status_t *status, dc_status_t error);
 
+dc_status_t
+dc_file_read (dc_buffer_t **out, dc_context_t *context, const char *filename);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
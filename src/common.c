@@ -20,9 +20,11 @@
  */
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <assert.h>
 
 #include "common-private.h"
+#include "context-private.h"
 
 void
 dc_status_set_error (dc_status_t *status, dc_status_t error)
@@ -32,3 +34,61 @@ dc_status_set_error (dc_status_t *status, dc_status_t error)
 	if (*status == DC_STATUS_SUCCESS)
 		*status = error;
 }
+
+dc_status_t
+dc_file_read (dc_buffer_t **out, dc_context_t *context, const char *filename)
+{
+	dc_buffer_t *buffer = NULL;
+	FILE *fp = NULL;
+
+	if (out == NULL || filename == NULL) {
+		ERROR (context, "Invalid arguments.");
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	// Map the file directly into memory. Reading the file is only
+	// required where memory mapping is not available.
+	buffer = dc_buffer_new_mapped (filename);
+	if (buffer) {
+		*out = buffer;
+		return DC_STATUS_SUCCESS;
+	}
+
+	fp = fopen (filename, "rb");
+	if (fp == NULL) {
+		ERROR (context, "Failed to open the file.");
+		return DC_STATUS_IO;
+	}
+
+	buffer = dc_buffer_new (0);
+	if (buffer == NULL) {
+		ERROR (context, "Failed to allocate memory.");
+		fclose (fp);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Read the entire file into the buffer.
+	size_t n = 0;
+	unsigned char block[4096];
+	while ((n = fread (block, 1, sizeof (block), fp)) > 0) {
+		if (!dc_buffer_append (buffer, block, n)) {
+			ERROR (context, "Failed to allocate memory.");
+			dc_buffer_free (buffer);
+			fclose (fp);
+			return DC_STATUS_NOMEMORY;
+		}
+	}
+
+	if (ferror (fp)) {
+		ERROR (context, "Failed to read the file.");
+		dc_buffer_free (buffer);
+		fclose (fp);
+		return DC_STATUS_IO;
+	}
+
+	fclose (fp);
+
+	*out = buffer;
+
+	return DC_STATUS_SUCCESS;
+}
@@ -29,6 +29,8 @@
 #include <libdivecomputer/context.h>
 #include <libdivecomputer/custom_io.h>
 
+#include "capture.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -75,6 +77,9 @@ dc_context_hexdump (dc_context_t *context, dc_loglevel_t loglevel, const char *f
 dc_custom_io_t*
 _dc_context_custom_io (dc_context_t *context);
 
+dc_capture_t*
+_dc_context_capture (dc_context_t *context);
+
 dc_status_t
 dc_custom_io_serial_open(dc_iostream_t **out, dc_context_t *context, const char *name);
 
@@ -19,10 +19,17 @@
  * MA 02110-1301 USA
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 #ifdef _WIN32
 #define NOGDI
@@ -31,6 +38,7 @@
 
 #include "context-private.h"
 #include "timer.h"
+#include "capture.h"
 
 #include <libdivecomputer/custom_io.h>
 
@@ -41,9 +49,13 @@ struct dc_context_t {
 #ifdef ENABLE_LOGGING
 	char msg[8192 + 32];
 	dc_timer_t *timer;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t mutex;
+#endif
 #endif
 	dc_custom_io_t *custom_io;
 	dc_user_device_t *user_device;
+	dc_capture_t *capture;
 };
 
 #ifdef ENABLE_LOGGING
@@ -128,6 +140,22 @@ l_hexdump (char *str, size_t size, const unsigned char data[], size_t n)
 	return (n > maxlength ? -1 : length * 2);
 }
 
+static void
+dc_context_lock (dc_context_t *context)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock (&context->mutex);
+#endif
+}
+
+static void
+dc_context_unlock (dc_context_t *context)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock (&context->mutex);
+#endif
+}
+
 static void
 logfunc (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *msg, void *userdata)
 {
@@ -176,9 +204,13 @@ dc_context_new (dc_context_t **out)
 	memset (context->msg, 0, sizeof (context->msg));
 	context->timer = NULL;
 	dc_timer_new (&context->timer);
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_init (&context->mutex, NULL);
+#endif
 #endif
 
 	context->custom_io = NULL;
+	context->capture = NULL;
 
 	*out = context;
 
@@ -191,7 +223,14 @@ dc_context_free (dc_context_t *context)
 	if (context == NULL)
 		return DC_STATUS_SUCCESS;
 
+	dc_capture_free (context->capture);
+
+#ifdef ENABLE_LOGGING
 	dc_timer_free (context->timer);
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_destroy (&context->mutex);
+#endif
+#endif
 	free (context);
 
 	return DC_STATUS_SUCCESS;
@@ -209,12 +248,57 @@ dc_context_set_custom_io (dc_context_t *context, dc_custom_io_t *custom_io, dc_u
 	return DC_STATUS_SUCCESS;
 }
 
+static dc_status_t
+dc_context_set_capture_mode (dc_context_t *context, const char *filename, dc_capture_mode_t mode, double speed)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_capture_t *capture = NULL;
+
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (filename) {
+		status = dc_capture_new (&capture, context, filename, mode, speed);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+	}
+
+	dc_capture_free (context->capture);
+	context->capture = capture;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_context_set_capture (dc_context_t *context, const char *filename)
+{
+	return dc_context_set_capture_mode (context, filename, DC_CAPTURE_RECORD, 0.0);
+}
+
+dc_status_t
+dc_context_set_replay (dc_context_t *context, const char *filename, double speed)
+{
+	if (speed < 0)
+		return DC_STATUS_INVALIDARGS;
+
+	return dc_context_set_capture_mode (context, filename, DC_CAPTURE_REPLAY, speed);
+}
+
 dc_custom_io_t*
 _dc_context_custom_io (dc_context_t *context)
 {
 	return context->custom_io;
 }
 
+dc_capture_t*
+_dc_context_capture (dc_context_t *context)
+{
+	if (context == NULL)
+		return NULL;
+
+	return context->capture;
+}
+
 dc_status_t
 dc_context_set_loglevel (dc_context_t *context, dc_loglevel_t loglevel)
 {
@@ -259,11 +343,17 @@ dc_context_log (dc_context_t *context, dc_loglevel_t loglevel, const char *file,
 	if (context->logfunc == NULL)
 		return DC_STATUS_SUCCESS;
 
+	// The message buffer is shared. Serialize the logging for the
+	// functions that use the context from multiple threads.
+	dc_context_lock (context);
+
 	va_start (ap, format);
 	l_vsnprintf (context->msg, sizeof (context->msg), format, ap);
 	va_end (ap);
 
 	context->logfunc (context, loglevel, file, line, function, context->msg, context->userdata);
+
+	dc_context_unlock (context);
 #endif
 
 	return DC_STATUS_SUCCESS;
@@ -326,6 +416,8 @@ dc_context_hexdump (dc_context_t *context, dc_loglevel_t loglevel, const char *f
 	if (context->logfunc == NULL)
 		return DC_STATUS_SUCCESS;
 
+	dc_context_lock (context);
+
 	n = l_snprintf (context->msg, sizeof (context->msg), "%s: size=%u, data=", prefix, size);
 
 	if (n >= 0) {
@@ -333,6 +425,8 @@ dc_context_hexdump (dc_context_t *context, dc_loglevel_t loglevel, const char *f
 	}
 
 	context->logfunc (context, loglevel, file, line, function, context->msg, context->userdata);
+
+	dc_context_unlock (context);
 #endif
 
 	return DC_STATUS_SUCCESS;
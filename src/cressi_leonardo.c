@@ -112,31 +112,44 @@ cressi_leonardo_packet (cressi_leonardo_device_t *device, const unsigned char co
 		return status;
 	}
 
+	assert (asize <= PACKETSIZE);
+
 	// Receive the answer of the device.
-	status = dc_iostream_read (device->iostream, answer, asize, NULL);
+	unsigned char packet[2 * (PACKETSIZE + 3)] = {0};
+	unsigned int psize = 2 * (asize + 3);
+	status = dc_iostream_read (device->iostream, packet, psize, NULL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to receive the answer.");
 		return status;
 	}
 
 	// Verify the header and trailer of the packet.
-	if (answer[0] != '{' || answer[asize - 1] != '}') {
+	if (packet[0] != '{' || packet[psize - 1] != '}') {
 		ERROR (abstract->context, "Unexpected answer header/trailer byte.");
 		return DC_STATUS_PROTOCOL;
 	}
 
 	// Convert the checksum of the packet.
 	unsigned char checksum[2] = {0};
-	array_convert_hex2bin (answer + asize - 5, 4, checksum, sizeof(checksum));
+	if (array_convert_hex2bin (packet + psize - 5, 4, checksum, sizeof(checksum)) != 0) {
+		ERROR (abstract->context, "Unexpected answer checksum.");
+		return DC_STATUS_PROTOCOL;
+	}
 
 	// Verify the checksum of the packet.
 	unsigned short crc = array_uint16_be (checksum);
-	unsigned short ccrc = checksum_crc_ccitt_uint16 (answer + 1, asize - 6);
+	unsigned short ccrc = checksum_crc_ccitt_uint16 (packet + 1, psize - 6);
 	if (crc != ccrc) {
 		ERROR (abstract->context, "Unexpected answer checksum.");
 		return DC_STATUS_PROTOCOL;
 	}
 
+	// Convert the data of the packet.
+	if (array_convert_hex2bin (packet + 1, 2 * asize, answer, asize) != 0) {
+		ERROR (abstract->context, "Unexpected answer data.");
+		return DC_STATUS_PROTOCOL;
+	}
+
 	return DC_STATUS_SUCCESS;
 }
 
@@ -155,6 +168,8 @@ cressi_leonardo_transfer (cressi_leonardo_device_t *device, const unsigned char
 		if (nretries++ >= MAXRETRIES)
 			return rc;
 
+		device_statistics_retry ((dc_device_t *) device);
+
 		// Discard any garbage bytes.
 		dc_iostream_sleep (device->iostream, 100);
 		dc_iostream_purge (device->iostream, DC_DIRECTION_INPUT);
@@ -190,6 +205,9 @@ cressi_leonardo_device_open (dc_device_t **out, dc_context_t *context, const cha
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->iostream);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_iostream_configure (device->iostream, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -298,14 +316,10 @@ cressi_leonardo_device_read (dc_device_t *abstract, unsigned int address, unsign
 		cressi_leonardo_make_ascii (raw, sizeof (raw), command, sizeof (command));
 
 		// Send the command and receive the answer.
-		unsigned char answer[2 * (PACKETSIZE + 3)] = {0};
-		rc = cressi_leonardo_transfer (device, command, sizeof (command), answer, 2 * (len + 3));
+		rc = cressi_leonardo_transfer (device, command, sizeof (command), data, len);
 		if (rc != DC_STATUS_SUCCESS)
 			return rc;
 
-		// Extract the raw data from the packet.
-		array_convert_hex2bin (answer + 1, 2 * len, data, len);
-
 		nbytes += len;
 		address += len;
 		data += len;
@@ -38,6 +38,13 @@ typedef int (*dc_filter_t) (dc_transport_t transport, const void *userdata);
 dc_filter_t
 dc_descriptor_get_filter (dc_descriptor_t *descriptor);
 
+/*
+ * Find the descriptor of a device found on the given transport. The
+ * userdata is the same as for the filter function.
+ */
+dc_status_t
+dc_descriptor_match (dc_descriptor_t **descriptor, dc_transport_t transport, const void *userdata);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
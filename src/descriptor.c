@@ -64,6 +64,20 @@ struct dc_descriptor_t {
 	dc_filter_t filter;
 };
 
+typedef struct dc_usb_model_t {
+	unsigned short vid;
+	unsigned short pid;
+	dc_family_t type;
+	unsigned int model;
+} dc_usb_model_t;
+
+typedef struct dc_bluetooth_model_t {
+	const char *name;
+	size_t prefix;
+	dc_family_t type;
+	unsigned int model;
+} dc_bluetooth_model_t;
+
 typedef struct dc_descriptor_iterator_t {
 	dc_iterator_t base;
 	size_t current;
@@ -352,6 +366,77 @@ static const dc_descriptor_t g_descriptors[] = {
 	{"Cochran", "EMC-20H",      DC_FAMILY_COCHRAN_COMMANDER, 5, NULL},
 };
 
+/*
+ * The USB identifiers of the supported devices. The table is sorted on the
+ * vendor and product identifiers, such that it can be searched with a binary
+ * search. Each entry maps to the device descriptor with the same family and
+ * model number.
+ */
+
+static const dc_usb_model_t g_usb_models[] = {
+	{0x1493, 0x0030, DC_FAMILY_SUUNTO_EONSTEEL, 0}, // Eon Steel
+	{0x1493, 0x0033, DC_FAMILY_SUUNTO_EONSTEEL, 1}, // Eon Core
+	{0x2e6c, 0x3201, DC_FAMILY_UWATEC_G2, 0x32}, // G2
+	{0xc251, 0x2006, DC_FAMILY_UWATEC_G2, 0x22}, // Aladin Square
+};
+
+static const dc_usb_model_t *
+dc_usb_model_lookup (unsigned int vid, unsigned int pid)
+{
+	unsigned int key = (vid << 16) | pid;
+
+	size_t lo = 0, hi = C_ARRAY_SIZE (g_usb_models);
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		const dc_usb_model_t *entry = &g_usb_models[mid];
+		unsigned int value = ((unsigned int) entry->vid << 16) | entry->pid;
+		if (value == key)
+			return entry;
+		else if (value < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+/*
+ * The bluetooth names of the supported devices. A non-zero prefix length
+ * indicates only the first characters of the name are fixed, and the
+ * remainder contains a serial number. The name identifies only the family
+ * for some devices, and then the model number is just a default.
+ */
+
+static const dc_bluetooth_model_t g_bluetooth_models[] = {
+	{"OSTC",     4, DC_FAMILY_HW_OSTC3, 0x0A},
+	{"FROG",     4, DC_FAMILY_HW_FROG, 0},
+	{"Predator", 0, DC_FAMILY_SHEARWATER_PREDATOR, 2},
+	{"Petrel",   0, DC_FAMILY_SHEARWATER_PETREL, 3},
+	{"Nerd",     0, DC_FAMILY_SHEARWATER_PETREL, 4},
+	{"Perdix",   0, DC_FAMILY_SHEARWATER_PETREL, 5},
+};
+
+static const dc_bluetooth_model_t *
+dc_bluetooth_model_lookup (const char *name)
+{
+	if (name == NULL)
+		return NULL;
+
+	for (size_t i = 0; i < C_ARRAY_SIZE (g_bluetooth_models); ++i) {
+		const dc_bluetooth_model_t *entry = &g_bluetooth_models[i];
+		if (entry->prefix) {
+			if (strncasecmp (name, entry->name, entry->prefix) == 0)
+				return entry;
+		} else {
+			if (strcasecmp (name, entry->name) == 0)
+				return entry;
+		}
+	}
+
+	return NULL;
+}
+
 static int
 dc_filter_internal_name (const char *name, const char *values[], size_t count)
 {
@@ -368,19 +453,14 @@ dc_filter_internal_name (const char *name, const char *values[], size_t count)
 }
 
 static int
-dc_filter_internal_usb (const dc_usb_desc_t *desc, const dc_usb_desc_t values[], size_t count)
+dc_filter_internal_usb (const dc_usb_desc_t *desc, dc_family_t type)
 {
 	if (desc == NULL)
 		return 0;
 
-	for (size_t i = 0; i < count; ++i) {
-		if (desc->vid == values[i].vid &&
-			desc->pid == values[i].pid) {
-			return 1;
-		}
-	}
+	const dc_usb_model_t *entry = dc_usb_model_lookup (desc->vid, desc->pid);
 
-	return 0;
+	return entry != NULL && entry->type == type;
 }
 
 static int dc_filter_uwatec (dc_transport_t transport, const void *userdata)
@@ -394,15 +474,11 @@ static int dc_filter_uwatec (dc_transport_t transport, const void *userdata)
 		"UWATEC Galileo",
 		"UWATEC Galileo Sol",
 	};
-	static const dc_usb_desc_t usbhid[] = {
-		{0x2e6c, 0x3201}, // G2
-		{0xc251, 0x2006}, // Aladin Square
-	};
 
 	if (transport == DC_TRANSPORT_IRDA) {
 		return dc_filter_internal_name ((const char *) userdata, irda, C_ARRAY_SIZE(irda));
 	} else if (transport == DC_TRANSPORT_USBHID) {
-		return dc_filter_internal_usb ((const dc_usb_desc_t *) userdata, usbhid, C_ARRAY_SIZE(usbhid));
+		return dc_filter_internal_usb ((const dc_usb_desc_t *) userdata, DC_FAMILY_UWATEC_G2);
 	}
 
 	return 1;
@@ -410,13 +486,8 @@ static int dc_filter_uwatec (dc_transport_t transport, const void *userdata)
 
 static int dc_filter_suunto (dc_transport_t transport, const void *userdata)
 {
-	static const dc_usb_desc_t usbhid[] = {
-		{0x1493, 0x0030}, // Eon Steel
-		{0x1493, 0x0033}, // Eon Core
-	};
-
 	if (transport == DC_TRANSPORT_USBHID) {
-		return dc_filter_internal_usb ((const dc_usb_desc_t *) userdata, usbhid, C_ARRAY_SIZE(usbhid));
+		return dc_filter_internal_usb ((const dc_usb_desc_t *) userdata, DC_FAMILY_SUUNTO_EONSTEEL);
 	}
 
 	return 1;
@@ -425,8 +496,9 @@ static int dc_filter_suunto (dc_transport_t transport, const void *userdata)
 static int dc_filter_hw (dc_transport_t transport, const void *userdata)
 {
 	if (transport == DC_TRANSPORT_BLUETOOTH) {
-		return strncasecmp ((const char *) userdata, "OSTC", 4) == 0 ||
-			strncasecmp ((const char *) userdata, "FROG", 4) == 0;
+		const dc_bluetooth_model_t *entry = dc_bluetooth_model_lookup ((const char *) userdata);
+		return entry != NULL &&
+			(entry->type == DC_FAMILY_HW_OSTC3 || entry->type == DC_FAMILY_HW_FROG);
 	}
 
 	return 1;
@@ -434,15 +506,10 @@ static int dc_filter_hw (dc_transport_t transport, const void *userdata)
 
 static int dc_filter_shearwater (dc_transport_t transport, const void *userdata)
 {
-	static const char *bluetooth[] = {
-		"Predator",
-		"Petrel",
-		"Nerd",
-		"Perdix",
-	};
-
 	if (transport == DC_TRANSPORT_BLUETOOTH) {
-		return dc_filter_internal_name ((const char *) userdata, bluetooth, C_ARRAY_SIZE(bluetooth));
+		const dc_bluetooth_model_t *entry = dc_bluetooth_model_lookup ((const char *) userdata);
+		return entry != NULL &&
+			(entry->type == DC_FAMILY_SHEARWATER_PREDATOR || entry->type == DC_FAMILY_SHEARWATER_PETREL);
 	}
 
 	return 1;
@@ -488,6 +555,83 @@ dc_descriptor_iterator_next (dc_iterator_t *abstract, void *out)
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_descriptor_find (dc_descriptor_t **out, dc_family_t type, unsigned int model)
+{
+	const dc_descriptor_t *descriptor = NULL;
+
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	for (size_t i = 0; i < C_ARRAY_SIZE (g_descriptors); ++i) {
+		if (g_descriptors[i].type != type)
+			continue;
+
+		if (g_descriptors[i].model == model) {
+			// Exact match found.
+			descriptor = &g_descriptors[i];
+			break;
+		}
+
+		// Possible match found. Keep searching for an exact match.
+		// If no exact match is found, the first match is returned.
+		if (descriptor == NULL)
+			descriptor = &g_descriptors[i];
+	}
+
+	// See dc_descriptor_iterator_next() for the const cast.
+	*out = (dc_descriptor_t *) descriptor;
+
+	return descriptor ? DC_STATUS_SUCCESS : DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_descriptor_find_usb (dc_descriptor_t **out, unsigned int vid, unsigned int pid)
+{
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	const dc_usb_model_t *entry = dc_usb_model_lookup (vid, pid);
+	if (entry == NULL) {
+		*out = NULL;
+		return DC_STATUS_UNSUPPORTED;
+	}
+
+	return dc_descriptor_find (out, entry->type, entry->model);
+}
+
+dc_status_t
+dc_descriptor_match (dc_descriptor_t **out, dc_transport_t transport, const void *userdata)
+{
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*out = NULL;
+
+	if (transport == DC_TRANSPORT_USBHID) {
+		const dc_usb_desc_t *desc = (const dc_usb_desc_t *) userdata;
+		if (desc == NULL)
+			return DC_STATUS_UNSUPPORTED;
+		return dc_descriptor_find_usb (out, desc->vid, desc->pid);
+	} else if (transport == DC_TRANSPORT_BLUETOOTH) {
+		const dc_bluetooth_model_t *entry = dc_bluetooth_model_lookup ((const char *) userdata);
+		if (entry == NULL)
+			return DC_STATUS_UNSUPPORTED;
+		return dc_descriptor_find (out, entry->type, entry->model);
+	} else if (transport == DC_TRANSPORT_IRDA) {
+		for (size_t i = 0; i < C_ARRAY_SIZE (g_descriptors); ++i) {
+			dc_descriptor_t *descriptor = (dc_descriptor_t *) &g_descriptors[i];
+			if (dc_descriptor_get_transport (descriptor) == DC_TRANSPORT_IRDA &&
+				descriptor->filter && descriptor->filter (transport, userdata)) {
+				*out = descriptor;
+				return DC_STATUS_SUCCESS;
+			}
+		}
+	}
+
+	return DC_STATUS_UNSUPPORTED;
+}
+
 void
 dc_descriptor_free (dc_descriptor_t *descriptor)
 {
@@ -26,6 +26,7 @@
 
 #include <libdivecomputer/context.h>
 #include <libdivecomputer/device.h>
+#include <libdivecomputer/iostream.h>
 
 #include "common-private.h"
 
@@ -54,6 +55,10 @@ struct dc_device_t {
 	// Cached events for the parsers.
 	dc_event_devinfo_t devinfo;
 	dc_event_clock_t clock;
+	// Memory image of a previous download.
+	dc_buffer_t *cache;
+	// Transfer statistics.
+	dc_statistics_t statistics;
 };
 
 struct dc_device_vtable_t {
@@ -91,9 +96,24 @@ device_event_emit (dc_device_t *device, dc_event_type_t event, const void *data)
 int
 device_is_cancelled (dc_device_t *device);
 
+void
+device_statistics_retry (dc_device_t *device);
+
+void
+device_statistics_attach (dc_device_t *device, dc_iostream_t *iostream);
+
 dc_status_t
 device_dump_read (dc_device_t *device, unsigned char data[], unsigned int size, unsigned int blocksize);
 
+const unsigned char *
+device_cache_get (dc_device_t *device, unsigned int size);
+
+dc_status_t
+device_dump_read_range (dc_device_t *device, dc_event_progress_t *progress, unsigned char data[], unsigned int size, unsigned int begin, unsigned int end, unsigned int pagesize, unsigned int blocksize);
+
+dc_status_t
+device_dump_read_ringbuffer (dc_device_t *device, dc_event_progress_t *progress, unsigned char data[], unsigned int size, unsigned int rb_begin, unsigned int rb_end, unsigned int first, unsigned int last, unsigned int pagesize, unsigned int blocksize);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
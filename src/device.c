@@ -59,7 +59,9 @@
 #include "cochran_commander.h"
 
 #include "device-private.h"
+#include "iostream-private.h"
 #include "context-private.h"
+#include "timer.h"
 
 dc_device_t *
 dc_device_allocate (dc_context_t *context, const dc_device_vtable_t *vtable)
@@ -90,12 +92,21 @@ dc_device_allocate (dc_context_t *context, const dc_device_vtable_t *vtable)
 	memset (&device->devinfo, 0, sizeof (device->devinfo));
 	memset (&device->clock, 0, sizeof (device->clock));
 
+	device->cache = NULL;
+
+	memset (&device->statistics, 0, sizeof (device->statistics));
+
 	return device;
 }
 
 void
 dc_device_deallocate (dc_device_t *device)
 {
+	if (device == NULL)
+		return;
+
+	dc_buffer_free (device->cache);
+
 	free (device);
 }
 
@@ -281,6 +292,36 @@ dc_device_set_fingerprint (dc_device_t *device, const unsigned char data[], unsi
 }
 
 
+dc_status_t
+dc_device_set_cache (dc_device_t *device, const unsigned char data[], unsigned int size)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (data == NULL || size == 0) {
+		dc_buffer_free (device->cache);
+		device->cache = NULL;
+		return DC_STATUS_SUCCESS;
+	}
+
+	if (device->cache == NULL) {
+		device->cache = dc_buffer_new (size);
+		if (device->cache == NULL) {
+			ERROR (device->context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+	}
+
+	if (!dc_buffer_clear (device->cache) ||
+		!dc_buffer_append (device->cache, data, size)) {
+		ERROR (device->context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 dc_status_t
 dc_device_read (dc_device_t *device, unsigned int address, unsigned char data[], unsigned int size)
 {
@@ -362,16 +403,138 @@ device_dump_read (dc_device_t *device, unsigned char data[], unsigned int size,
 }
 
 
+const unsigned char *
+device_cache_get (dc_device_t *device, unsigned int size)
+{
+	if (device == NULL || device->cache == NULL)
+		return NULL;
+
+	if (dc_buffer_get_size (device->cache) != size) {
+		WARNING (device->context, "Ignoring the memory cache with a different size.");
+		return NULL;
+	}
+
+	return dc_buffer_get_data (device->cache);
+}
+
+
+dc_status_t
+device_dump_read_range (dc_device_t *device, dc_event_progress_t *progress, unsigned char data[], unsigned int size, unsigned int begin, unsigned int end, unsigned int pagesize, unsigned int blocksize)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (device->vtable->read == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	// Align the range to the page size.
+	begin = (begin / pagesize) * pagesize;
+	end = ((end + pagesize - 1) / pagesize) * pagesize;
+	if (end > size)
+		end = size;
+
+	unsigned int address = begin;
+	while (address < end) {
+		// Calculate the packet size.
+		unsigned int len = end - address;
+		if (len > blocksize)
+			len = blocksize;
+
+		// Read the packet.
+		dc_status_t rc = device->vtable->read (device, address, data + address, len);
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+
+		// Update and emit a progress event.
+		if (progress) {
+			progress->current += len;
+			device_event_emit (device, DC_EVENT_PROGRESS, progress);
+		}
+
+		address += len;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+dc_status_t
+device_dump_read_ringbuffer (dc_device_t *device, dc_event_progress_t *progress, unsigned char data[], unsigned int size, unsigned int rb_begin, unsigned int rb_end, unsigned int first, unsigned int last, unsigned int pagesize, unsigned int blocksize)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (first == last)
+		return DC_STATUS_SUCCESS;
+
+	if (first < last)
+		return device_dump_read_range (device, progress, data, size, first, last, pagesize, blocksize);
+
+	// Handle the ringbuffer wrap point.
+	rc = device_dump_read_range (device, progress, data, size, first, rb_end, pagesize, blocksize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	return device_dump_read_range (device, progress, data, size, rb_begin, last, pagesize, blocksize);
+}
+
+
+typedef struct device_foreach_t {
+	dc_device_t *device;
+	dc_dive_callback_t callback;
+	void *userdata;
+	dc_timer_t *timer;
+} device_foreach_t;
+
+static int
+device_foreach_callback (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+{
+	device_foreach_t *foreach = (device_foreach_t *) userdata;
+
+	dc_usecs_t begin = 0, end = 0;
+	dc_timer_now (foreach->timer, &begin);
+
+	int rc = foreach->callback (data, size, fingerprint, fsize, foreach->userdata);
+
+	if (dc_timer_now (foreach->timer, &end) == DC_STATUS_SUCCESS)
+		foreach->device->statistics.callback_time += (end - begin) / 1000000.0;
+
+	return rc;
+}
+
 dc_status_t
 dc_device_foreach (dc_device_t *device, dc_dive_callback_t callback, void *userdata)
 {
+	dc_status_t status = DC_STATUS_SUCCESS;
+
 	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	if (device->vtable->foreach == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return device->vtable->foreach (device, callback, userdata);
+	// Measure the time spent in the dive callback. Without a
+	// timer, the callback is passed to the backend unchanged.
+	device_foreach_t foreach = {device, callback, userdata, NULL};
+	if (callback == NULL || dc_timer_new (&foreach.timer) != DC_STATUS_SUCCESS)
+		return device->vtable->foreach (device, callback, userdata);
+
+	status = device->vtable->foreach (device, device_foreach_callback, &foreach);
+
+	dc_timer_free (foreach.timer);
+
+	return status;
+}
+
+
+dc_status_t
+dc_device_get_statistics (dc_device_t *device, dc_statistics_t *statistics)
+{
+	if (device == NULL || statistics == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*statistics = device->statistics;
+
+	return DC_STATUS_SUCCESS;
 }
 
 
@@ -462,6 +625,26 @@ device_event_emit (dc_device_t *device, dc_event_type_t event, const void *data)
 }
 
 
+void
+device_statistics_retry (dc_device_t *device)
+{
+	if (device == NULL)
+		return;
+
+	device->statistics.nretries++;
+}
+
+
+void
+device_statistics_attach (dc_device_t *device, dc_iostream_t *iostream)
+{
+	if (device == NULL)
+		return;
+
+	dc_iostream_set_statistics (iostream, &device->statistics);
+}
+
+
 int
 device_is_cancelled (dc_device_t *device)
 {
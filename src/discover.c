@@ -0,0 +1,296 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include <libdivecomputer/discover.h>
+
+#include "context-private.h"
+#include "descriptor-private.h"
+#include "iterator-private.h"
+#include "serial.h"
+#include "usbhid.h"
+#include "irda.h"
+#include "bluetooth.h"
+
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
+typedef struct dc_discover_t {
+	dc_context_t *context;
+	dc_descriptor_t *descriptor;
+	dc_discover_callback_t callback;
+	void *userdata;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t mutex;
+#endif
+} dc_discover_t;
+
+typedef dc_status_t (*dc_discover_scan_t) (dc_discover_t *discover);
+
+typedef struct dc_discover_worker_t {
+	dc_discover_t *discover;
+	dc_transport_t transport;
+	dc_discover_scan_t scan;
+	dc_status_t status;
+#ifdef HAVE_PTHREAD_H
+	pthread_t thread;
+	int running;
+#endif
+} dc_discover_worker_t;
+
+static void
+dc_discover_report (dc_discover_t *discover, dc_transport_t transport, const void *userdata, const char *name)
+{
+	dc_descriptor_t *descriptor = discover->descriptor;
+
+	// Identify the device. Serial ports can't be identified without
+	// communicating with the device, and are reported as is.
+	if (transport != DC_TRANSPORT_SERIAL) {
+		dc_descriptor_t *match = NULL;
+		if (dc_descriptor_match (&match, transport, userdata) != DC_STATUS_SUCCESS)
+			return;
+
+		if (descriptor == NULL) {
+			descriptor = match;
+		} else if (dc_descriptor_get_type (match) != dc_descriptor_get_type (descriptor)) {
+			return;
+		} else if (transport != DC_TRANSPORT_IRDA &&
+			dc_descriptor_get_model (match) != dc_descriptor_get_model (descriptor)) {
+			// The IrDA device name identifies only the family, so the
+			// model can't be compared until after connecting.
+			return;
+		}
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock (&discover->mutex);
+#endif
+
+	discover->callback (transport, descriptor, name, discover->userdata);
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock (&discover->mutex);
+#endif
+}
+
+static dc_status_t
+dc_discover_serial (dc_discover_t *discover)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_iterator_t *iterator = NULL;
+	dc_serial_device_t *device = NULL;
+
+	// Serial ports can't be identified, so scanning them is only
+	// useful for devices that are actually connected that way.
+	if (discover->descriptor &&
+		dc_descriptor_get_transport (discover->descriptor) != DC_TRANSPORT_SERIAL)
+		return DC_STATUS_SUCCESS;
+
+	status = dc_serial_iterator_new (&iterator, discover->context, discover->descriptor);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	while ((status = dc_iterator_next (iterator, &device)) == DC_STATUS_SUCCESS) {
+		const char *name = dc_serial_device_get_name (device);
+		dc_discover_report (discover, DC_TRANSPORT_SERIAL, name, name);
+		dc_serial_device_free (device);
+	}
+
+	dc_iterator_free (iterator);
+
+	return status == DC_STATUS_DONE ? DC_STATUS_SUCCESS : status;
+}
+
+static dc_status_t
+dc_discover_usbhid (dc_discover_t *discover)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_iterator_t *iterator = NULL;
+	dc_usbhid_device_t *device = NULL;
+
+	status = dc_usbhid_iterator_new (&iterator, discover->context, discover->descriptor);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	while ((status = dc_iterator_next (iterator, &device)) == DC_STATUS_SUCCESS) {
+		dc_usb_desc_t usb = {
+			dc_usbhid_device_get_vid (device),
+			dc_usbhid_device_get_pid (device)};
+		dc_discover_report (discover, DC_TRANSPORT_USBHID, &usb, NULL);
+		dc_usbhid_device_free (device);
+	}
+
+	dc_iterator_free (iterator);
+
+	return status == DC_STATUS_DONE ? DC_STATUS_SUCCESS : status;
+}
+
+static dc_status_t
+dc_discover_irda (dc_discover_t *discover)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_iterator_t *iterator = NULL;
+	dc_irda_device_t *device = NULL;
+
+	status = dc_irda_iterator_new (&iterator, discover->context, discover->descriptor);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	while ((status = dc_iterator_next (iterator, &device)) == DC_STATUS_SUCCESS) {
+		const char *name = dc_irda_device_get_name (device);
+		dc_discover_report (discover, DC_TRANSPORT_IRDA, name, name);
+		dc_irda_device_free (device);
+	}
+
+	dc_iterator_free (iterator);
+
+	return status == DC_STATUS_DONE ? DC_STATUS_SUCCESS : status;
+}
+
+static dc_status_t
+dc_discover_bluetooth (dc_discover_t *discover)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_iterator_t *iterator = NULL;
+	dc_bluetooth_device_t *device = NULL;
+
+	status = dc_bluetooth_iterator_new (&iterator, discover->context, discover->descriptor);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	while ((status = dc_iterator_next (iterator, &device)) == DC_STATUS_SUCCESS) {
+		char address[DC_BLUETOOTH_SIZE];
+		dc_bluetooth_addr2str (dc_bluetooth_device_get_address (device), address, sizeof (address));
+		dc_discover_report (discover, DC_TRANSPORT_BLUETOOTH, dc_bluetooth_device_get_name (device), address);
+		dc_bluetooth_device_free (device);
+	}
+
+	dc_iterator_free (iterator);
+
+	return status == DC_STATUS_DONE ? DC_STATUS_SUCCESS : status;
+}
+
+static void
+dc_discover_run (dc_discover_worker_t *worker)
+{
+	worker->status = worker->scan (worker->discover);
+}
+
+#ifdef HAVE_PTHREAD_H
+static void *
+dc_discover_thread (void *arg)
+{
+	dc_discover_run ((dc_discover_worker_t *) arg);
+	return NULL;
+}
+#endif
+
+dc_status_t
+dc_discover (dc_context_t *context, dc_descriptor_t *descriptor, dc_discover_callback_t callback, void *userdata)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_discover_t discover;
+	dc_discover_worker_t workers[4];
+
+	if (callback == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	memset (&discover, 0, sizeof (discover));
+	discover.context = context;
+	discover.descriptor = descriptor;
+	discover.callback = callback;
+	discover.userdata = userdata;
+
+	// The bluetooth inquiry and the IrDA discovery take several seconds
+	// each, and the usb enumeration is not instant either. Each transport
+	// is scanned from its own thread (if available), such that the total
+	// time is determined by the slowest transport only.
+	static const struct {
+		dc_transport_t transport;
+		dc_discover_scan_t scan;
+	} transports[C_ARRAY_SIZE (workers)] = {
+		{DC_TRANSPORT_BLUETOOTH, dc_discover_bluetooth},
+		{DC_TRANSPORT_IRDA, dc_discover_irda},
+		{DC_TRANSPORT_USBHID, dc_discover_usbhid},
+		{DC_TRANSPORT_SERIAL, dc_discover_serial},
+	};
+
+	memset (workers, 0, sizeof (workers));
+	for (size_t i = 0; i < C_ARRAY_SIZE (workers); ++i) {
+		workers[i].discover = &discover;
+		workers[i].transport = transports[i].transport;
+		workers[i].scan = transports[i].scan;
+		workers[i].status = DC_STATUS_SUCCESS;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	if (pthread_mutex_init (&discover.mutex, NULL) != 0) {
+		ERROR (context, "Failed to initialize the mutex.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Start the worker threads. If a thread can't be started, the
+	// transport is scanned from the calling thread instead.
+	for (size_t i = 0; i < C_ARRAY_SIZE (workers); ++i) {
+		workers[i].running = (pthread_create (&workers[i].thread, NULL, dc_discover_thread, &workers[i]) == 0);
+		if (!workers[i].running) {
+			WARNING (context, "Failed to start the discovery thread.");
+		}
+	}
+
+	for (size_t i = 0; i < C_ARRAY_SIZE (workers); ++i) {
+		if (workers[i].running) {
+			pthread_join (workers[i].thread, NULL);
+		} else {
+			dc_discover_run (&workers[i]);
+		}
+	}
+
+	pthread_mutex_destroy (&discover.mutex);
+#else
+	for (size_t i = 0; i < C_ARRAY_SIZE (workers); ++i) {
+		dc_discover_run (&workers[i]);
+	}
+#endif
+
+	// Transports without support are silently skipped. Other errors
+	// are reported, but don't discard the results of the other ones.
+	for (size_t i = 0; i < C_ARRAY_SIZE (workers); ++i) {
+		if (workers[i].status == DC_STATUS_SUCCESS ||
+			workers[i].status == DC_STATUS_UNSUPPORTED)
+			continue;
+
+		ERROR (context, "Failed to scan transport %u (%i).",
+			workers[i].transport, workers[i].status);
+		if (status == DC_STATUS_SUCCESS)
+			status = workers[i].status;
+	}
+
+	return status;
+}
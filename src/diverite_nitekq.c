@@ -174,6 +174,9 @@ diverite_nitekq_device_open (dc_device_t **out, dc_context_t *context, const cha
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->iostream);
+
 	// Set the serial communication protocol (9600 8N1).
 	status = dc_iostream_configure (device->iostream, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -251,8 +254,53 @@ diverite_nitekq_device_set_fingerprint (dc_device_t *abstract, const unsigned ch
 }
 
 
+static unsigned int
+diverite_nitekq_get_limit (diverite_nitekq_device_t *device, const unsigned char data[])
+{
+	// Get the end of profile pointer.
+	unsigned int eop = array_uint16_be(data + EOP);
+	if (eop < RB_PROFILE_BEGIN || eop >= RB_PROFILE_END)
+		return SZ_MEMORY;
+
+	// Find the highest memory address that is needed to extract all new
+	// dives. The logbook entries are walked in the same order as in the
+	// extraction function. A profile that wraps around the end of the
+	// ringbuffer requires the entire memory.
+	unsigned int limit = RB_PROFILE_BEGIN;
+	unsigned int previous = eop;
+	for (unsigned int i = 0; i < 10; ++i) {
+		// Get the pointer to the logbook entry.
+		const unsigned char *p = data + LOGBOOK + i * SZ_LOGBOOK;
+
+		// Abort if an empty logbook is found.
+		if (array_isequal (p, SZ_LOGBOOK, 0x00))
+			break;
+
+		// Get the address of the profile data.
+		unsigned int address = array_uint16_be(data + ADDRESS + i * 2);
+		if (address < RB_PROFILE_BEGIN || address >= RB_PROFILE_END)
+			return SZ_MEMORY;
+
+		// Check the fingerprint data.
+		if (memcmp (p, device->fingerprint, sizeof (device->fingerprint)) == 0)
+			break;
+
+		if (previous > address) {
+			if (limit < previous)
+				limit = previous;
+		} else {
+			return SZ_MEMORY;
+		}
+
+		previous = address;
+	}
+
+	return limit;
+}
+
+
 static dc_status_t
-diverite_nitekq_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
+diverite_nitekq_download (dc_device_t *abstract, dc_buffer_t *buffer, int incremental)
 {
 	diverite_nitekq_device_t *device = (diverite_nitekq_device_t*) abstract;
 	dc_status_t rc = DC_STATUS_SUCCESS;
@@ -309,7 +357,13 @@ diverite_nitekq_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		return rc;
 	}
 
+	unsigned int limit = SZ_MEMORY;
 	for (unsigned int i = 0; i < 128; ++i) {
+		// Stop requesting memory blocks once all the
+		// data needed for the new dives is available.
+		if (i * SZ_PACKET >= limit)
+			break;
+
 		// Request the next memory block.
 		rc = diverite_nitekq_send (device, BLOCK);
 		if (rc != DC_STATUS_SUCCESS) {
@@ -324,15 +378,36 @@ diverite_nitekq_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 
 		dc_buffer_append (buffer, packet, sizeof (packet));
 
+		// Once the logbook and the profile pointers are available, the
+		// number of memory blocks that still need to be downloaded is
+		// known in advance.
+		if (incremental && i * SZ_PACKET < RB_PROFILE_BEGIN && (i + 1) * SZ_PACKET >= RB_PROFILE_BEGIN) {
+			limit = diverite_nitekq_get_limit (device, dc_buffer_get_data (buffer) + SZ_PACKET);
+			progress.maximum = SZ_PACKET + (limit + SZ_PACKET - 1) / SZ_PACKET * SZ_PACKET;
+		}
+
 		// Update and emit a progress event.
 		progress.current += SZ_PACKET;
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 	}
 
+	// Blocks that were not downloaded are left empty.
+	if (!dc_buffer_resize (buffer, SZ_PACKET + SZ_MEMORY)) {
+		ERROR (abstract->context, "Insufficient buffer space available.");
+		return DC_STATUS_NOMEMORY;
+	}
+
 	return DC_STATUS_SUCCESS;
 }
 
 
+static dc_status_t
+diverite_nitekq_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
+{
+	return diverite_nitekq_download (abstract, buffer, 0);
+}
+
+
 static dc_status_t
 diverite_nitekq_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
@@ -340,7 +415,7 @@ diverite_nitekq_device_foreach (dc_device_t *abstract, dc_dive_callback_t callba
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
-	dc_status_t rc = diverite_nitekq_device_dump (abstract, buffer);
+	dc_status_t rc = diverite_nitekq_download (abstract, buffer, 1);
 	if (rc != DC_STATUS_SUCCESS) {
 		dc_buffer_free (buffer);
 		return rc;
@@ -65,6 +65,7 @@ typedef struct divesystem_idive_commands_t {
 	divesystem_idive_command_t header;
 	divesystem_idive_command_t sample;
 	unsigned int nsamples;
+	unsigned int window;
 } divesystem_idive_commands_t;
 
 typedef struct divesystem_idive_device_t {
@@ -96,6 +97,7 @@ static const divesystem_idive_commands_t idive = {
 	{0xA0, 0x32},
 	{0xA8, 0x2A},
 	1,
+	1,
 };
 
 static const divesystem_idive_commands_t ix3m = {
@@ -104,6 +106,7 @@ static const divesystem_idive_commands_t ix3m = {
 	{0x79, 0x36},
 	{0x7A, 0x36},
 	1,
+	1,
 };
 
 static const divesystem_idive_commands_t ix3m_apos4 = {
@@ -112,6 +115,7 @@ static const divesystem_idive_commands_t ix3m_apos4 = {
 	{0x79, 0x36},
 	{0x7A, 0x40},
 	3,
+	4,
 };
 
 dc_status_t
@@ -142,6 +146,9 @@ divesystem_idive_device_open (dc_device_t **out, dc_context_t *context, const ch
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->iostream);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_iostream_configure (device->iostream, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -299,7 +306,7 @@ divesystem_idive_receive (divesystem_idive_device_t *device, unsigned char answe
 
 
 static dc_status_t
-divesystem_idive_packet (divesystem_idive_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int *errorcode)
+divesystem_idive_answer (divesystem_idive_device_t *device, unsigned char cmd, unsigned char answer[], unsigned int asize, unsigned int *errorcode)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_device_t *abstract = (dc_device_t *) device;
@@ -307,12 +314,6 @@ divesystem_idive_packet (divesystem_idive_device_t *device, const unsigned char
 	unsigned int length = sizeof(packet);
 	unsigned int errcode = 0;
 
-	// Send the command.
-	status = divesystem_idive_send (device, command, csize);
-	if (status != DC_STATUS_SUCCESS) {
-		goto error;
-	}
-
 	// Receive the answer.
 	status = divesystem_idive_receive (device, packet, &length);
 	if (status != DC_STATUS_SUCCESS) {
@@ -320,7 +321,7 @@ divesystem_idive_packet (divesystem_idive_device_t *device, const unsigned char
 	}
 
 	// Verify the command byte.
-	if (packet[0] != command[0]) {
+	if (packet[0] != cmd) {
 		ERROR (abstract->context, "Unexpected packet header.");
 		status = DC_STATUS_PROTOCOL;
 		goto error;
@@ -361,6 +362,25 @@ error:
 }
 
 
+static dc_status_t
+divesystem_idive_packet (divesystem_idive_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int *errorcode)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	// Send the command.
+	status = divesystem_idive_send (device, command, csize);
+	if (status != DC_STATUS_SUCCESS) {
+		if (errorcode) {
+			*errorcode = 0;
+		}
+		return status;
+	}
+
+	// Receive the answer.
+	return divesystem_idive_answer (device, command[0], answer, asize, errorcode);
+}
+
+
 static dc_status_t
 divesystem_idive_transfer (divesystem_idive_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int *errorcode)
 {
@@ -382,6 +402,8 @@ divesystem_idive_transfer (divesystem_idive_device_t *device, const unsigned cha
 		if (nretries++ >= MAXRETRIES)
 			break;
 
+		device_statistics_retry ((dc_device_t *) device);
+
 		// Delay the next attempt.
 		dc_iostream_sleep (device->iostream, 100);
 	}
@@ -393,6 +415,104 @@ divesystem_idive_transfer (divesystem_idive_device_t *device, const unsigned cha
 	return status;
 }
 
+static void
+divesystem_idive_drain (divesystem_idive_device_t *device)
+{
+	unsigned char buffer[MAXPACKET + 4];
+	size_t nbytes = 0;
+
+	// Read and discard data until the device stays silent for a full
+	// timeout period.
+	do {
+		nbytes = 0;
+		dc_iostream_read (device->iostream, buffer, sizeof (buffer), &nbytes);
+	} while (nbytes);
+}
+
+static dc_status_t
+divesystem_idive_samples (divesystem_idive_device_t *device, const divesystem_idive_commands_t *commands, unsigned int *window, unsigned int nsamples, dc_buffer_t *buffer, dc_event_progress_t *progress, unsigned int base, unsigned int *npipelined)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_device_t *abstract = (dc_device_t *) device;
+	unsigned char packet[MAXPACKET - 2];
+	unsigned int errcode = 0;
+
+	unsigned int count = commands->nsamples;
+	unsigned int size = commands->sample.size * count;
+	unsigned int npackets = (nsamples + count - 1) / count;
+
+	// With a window larger than one, several sample requests are sent
+	// ahead, without waiting for the previous answers. The answers are
+	// always returned in the same order as the requests.
+	unsigned int nsent = 0, nreceived = 0;
+	while (nreceived < npackets) {
+		if (*window > 1) {
+			// Keep the pipeline filled.
+			while (nsent < npackets && nsent - nreceived < *window) {
+				unsigned int idx = nsent * count + 1;
+				unsigned char cmd_sample[] = {commands->sample.cmd,
+					(idx     ) & 0xFF,
+					(idx >> 8) & 0xFF};
+				rc = divesystem_idive_send (device, cmd_sample, sizeof(cmd_sample));
+				if (rc != DC_STATUS_SUCCESS)
+					return rc;
+				nsent++;
+			}
+
+			if (nsent - nreceived > 1) {
+				(*npipelined)++;
+			}
+
+			rc = divesystem_idive_answer (device, commands->sample.cmd, packet, size, &errcode);
+			if (rc != DC_STATUS_SUCCESS) {
+				if (rc != DC_STATUS_PROTOCOL && rc != DC_STATUS_TIMEOUT)
+					return rc;
+
+				// Discard the outstanding answers, and request the
+				// remaining samples one packet at a time. The answers
+				// only carry the command byte, so a late answer would
+				// be mistaken for the next one.
+				WARNING (abstract->context, "Pipelined sample request failed, falling back to lock-step.");
+				divesystem_idive_drain (device);
+				*window = 1;
+				nsent = nreceived;
+				continue;
+			}
+		} else {
+			unsigned int idx = nreceived * count + 1;
+			unsigned char cmd_sample[] = {commands->sample.cmd,
+				(idx     ) & 0xFF,
+				(idx >> 8) & 0xFF};
+			rc = divesystem_idive_transfer (device, cmd_sample, sizeof(cmd_sample), packet, size, &errcode);
+			if (rc != DC_STATUS_SUCCESS)
+				return rc;
+			nsent = nreceived + 1;
+		}
+
+		// If the number of samples is not an exact multiple of the
+		// number of samples per packet, then the last packet
+		// appears to contain garbage data. Ignore those samples.
+		unsigned int j = nreceived * count;
+		unsigned int n = count;
+		if (j + n > nsamples) {
+			n = nsamples - j;
+		}
+
+		// Update and emit a progress event.
+		progress->current = base + STEP(j + n + 1, nsamples + 1);
+		device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+
+		if (!dc_buffer_append(buffer, packet, commands->sample.size * n)) {
+			ERROR (abstract->context, "Insufficient buffer space available.");
+			return DC_STATUS_NOMEMORY;
+		}
+
+		nreceived++;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
 static dc_status_t
 divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
@@ -457,15 +577,17 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 	// Calculate the number of dives.
 	unsigned int ndives = last - first + 1;
 
-	// Update and emit a progress event.
-	progress.maximum = ndives * NSTEPS;
-	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
-
-	dc_buffer_t *buffer = dc_buffer_new(0);
-	if (buffer == NULL) {
-		return DC_STATUS_NOMEMORY;
+	dc_buffer_t *headers = dc_buffer_new (0);
+	dc_buffer_t *buffer = dc_buffer_new (0);
+	if (headers == NULL || buffer == NULL) {
+		ERROR (abstract->context, "Failed to allocate memory.");
+		rc = DC_STATUS_NOMEMORY;
+		goto error_free;
 	}
 
+	// Scan the headers first, to find out exactly which dives are new.
+	// Each entry contains the dive number, followed by the header.
+	unsigned int nnew = 0;
 	for (unsigned int i = 0; i < ndives; ++i) {
 		unsigned int number = last - i;
 		unsigned char cmd_header[] = {commands->header.cmd,
@@ -477,15 +599,42 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 				WARNING(abstract->context, "Skipped unreadable dive!");
 				continue;
 			} else {
-				dc_buffer_free(buffer);
-				return rc;
+				goto error_free;
 			}
 		}
 
 		if (memcmp(packet + 7, device->fingerprint, sizeof(device->fingerprint)) == 0)
 			break;
 
-		unsigned int nsamples = array_uint16_le (packet + 1);
+		if (!dc_buffer_append (headers, cmd_header + 1, 2) ||
+			!dc_buffer_append (headers, packet, commands->header.size)) {
+			ERROR (abstract->context, "Insufficient buffer space available.");
+			rc = DC_STATUS_NOMEMORY;
+			goto error_free;
+		}
+
+		nnew++;
+	}
+
+	rc = DC_STATUS_SUCCESS;
+
+	// Update and emit a progress event.
+	progress.maximum = nnew * NSTEPS;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	unsigned int window = commands->window;
+	unsigned int npackets = 0, npipelined = 0;
+	for (unsigned int i = 0; i < nnew; ++i) {
+		const unsigned char *entry = dc_buffer_get_data (headers) + i * (2 + commands->header.size);
+		unsigned int nsamples = array_uint16_le (entry + 2 + 1);
+
+		// Select the dive again, because the sample command only
+		// contains the sample index.
+		unsigned char cmd_header[] = {commands->header.cmd, entry[0], entry[1]};
+		rc = divesystem_idive_transfer (device, cmd_header, sizeof(cmd_header), packet, commands->header.size, &errcode);
+		if (rc != DC_STATUS_SUCCESS) {
+			goto error_free;
+		}
 
 		// Update and emit a progress event.
 		progress.current = i * NSTEPS + STEP(1, nsamples + 1);
@@ -496,49 +645,29 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 
 		if (!dc_buffer_append(buffer, packet, commands->header.size)) {
 			ERROR (abstract->context, "Insufficient buffer space available.");
-			dc_buffer_free(buffer);
-			return rc;
+			rc = DC_STATUS_NOMEMORY;
+			goto error_free;
 		}
 
-		for (unsigned int j = 0; j < nsamples; j += commands->nsamples) {
-			unsigned int idx = j + 1;
-			unsigned char cmd_sample[] = {commands->sample.cmd,
-				(idx     ) & 0xFF,
-				(idx >> 8) & 0xFF};
-			rc = divesystem_idive_transfer (device, cmd_sample, sizeof(cmd_sample), packet, commands->sample.size * commands->nsamples, &errcode);
-			if (rc != DC_STATUS_SUCCESS) {
-				dc_buffer_free(buffer);
-				return rc;
-			}
-
-			// If the number of samples is not an exact multiple of the
-			// number of samples per packet, then the last packet
-			// appears to contain garbage data. Ignore those samples.
-			unsigned int n = commands->nsamples;
-			if (j + n > nsamples) {
-				n = nsamples - j;
-			}
-
-			// Update and emit a progress event.
-			progress.current = i * NSTEPS + STEP(j + n + 1, nsamples + 1);
-			device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
-
-			if (!dc_buffer_append(buffer, packet, commands->sample.size * n)) {
-				ERROR (abstract->context, "Insufficient buffer space available.");
-				dc_buffer_free(buffer);
-				return rc;
-			}
+		rc = divesystem_idive_samples (device, commands, &window, nsamples, buffer, &progress, i * NSTEPS, &npipelined);
+		if (rc != DC_STATUS_SUCCESS) {
+			goto error_free;
 		}
 
+		npackets += (nsamples + commands->nsamples - 1) / commands->nsamples;
+
 		unsigned char *data = dc_buffer_get_data(buffer);
 		unsigned int   size = dc_buffer_get_size(buffer);
 		if (callback && !callback (data, size, data + 7, sizeof(device->fingerprint), userdata)) {
-			dc_buffer_free (buffer);
-			return DC_STATUS_SUCCESS;
+			break;
 		}
 	}
 
-	dc_buffer_free(buffer);
+	INFO (abstract->context, "Download: packets=%u, pipelined=%u, window=%u",
+		npackets, npipelined, window);
 
-	return DC_STATUS_SUCCESS;
+error_free:
+	dc_buffer_free (buffer);
+	dc_buffer_free (headers);
+	return rc;
 }
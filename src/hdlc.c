@@ -0,0 +1,197 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include <zlib.h>	/* For crc32() */
+
+#include "hdlc.h"
+
+#include "context-private.h"
+#include "array.h"
+
+#define FLAG   0x7E
+#define ESC    0x7D
+#define ESCBIT 0x20
+
+#define STATE_IDLE   0
+#define STATE_DATA   1
+#define STATE_ESCAPE 2
+
+static void
+hdlc_decoder_append (hdlc_decoder_t *decoder, const unsigned char data[], unsigned int size)
+{
+	// Bytes that don't fit in the buffer are dropped, but still counted,
+	// such that the error can be reported at the end of the frame.
+	if (decoder->length < decoder->size) {
+		unsigned int available = decoder->size - decoder->length;
+		memcpy (decoder->data + decoder->length, data, size < available ? size : available);
+	}
+
+	decoder->length += size;
+}
+
+static void
+hdlc_decoder_update_crc (hdlc_decoder_t *decoder)
+{
+	// The last bytes of the frame are the checksum itself, and are not
+	// included in the checksum. Because the end of the frame is not known
+	// in advance, the checksum lags behind by the size of the checksum.
+	unsigned int length = decoder->length;
+	if (length > decoder->size || length < HDLC_CRCSIZE)
+		return;
+
+	length -= HDLC_CRCSIZE;
+	if (length > decoder->crclen) {
+		decoder->crc = crc32 (decoder->crc, decoder->data + decoder->crclen, length - decoder->crclen);
+		decoder->crclen = length;
+	}
+}
+
+void
+hdlc_decoder_init (hdlc_decoder_t *decoder, dc_context_t *context, unsigned char data[], unsigned int size)
+{
+	decoder->context = context;
+	decoder->data = data;
+	decoder->size = size;
+	decoder->length = 0;
+	decoder->state = STATE_IDLE;
+	decoder->crc = crc32 (0, NULL, 0);
+	decoder->crclen = 0;
+}
+
+dc_status_t
+hdlc_decoder_push (hdlc_decoder_t *decoder, const unsigned char data[], unsigned int size, unsigned int *consumed, unsigned int *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	unsigned int offset = 0;
+
+	while (offset < size && status == DC_STATUS_SUCCESS) {
+		unsigned char c = data[offset];
+
+		if (decoder->state == STATE_IDLE) {
+			if (c != FLAG) {
+				ERROR (decoder->context, "HDLC stream did not start with 7e");
+				return DC_STATUS_PROTOCOL;
+			}
+
+			// Initial 7e character - good
+			decoder->state = STATE_DATA;
+			offset++;
+			continue;
+		}
+
+		if (decoder->state == STATE_ESCAPE) {
+			if (c == FLAG || c == ESC) {
+				ERROR (decoder->context, "HDLC stream has escaped %02x character", c);
+				return DC_STATUS_PROTOCOL;
+			}
+
+			c ^= ESCBIT;
+			hdlc_decoder_append (decoder, &c, 1);
+			decoder->state = STATE_DATA;
+			offset++;
+			continue;
+		}
+
+		// Copy the run of bytes that need no unescaping at once.
+		unsigned int n = 0;
+		while (offset + n < size && data[offset + n] != FLAG && data[offset + n] != ESC)
+			n++;
+
+		hdlc_decoder_append (decoder, data + offset, n);
+		offset += n;
+
+		if (offset == size)
+			break;
+
+		if (data[offset++] == ESC) {
+			decoder->state = STATE_ESCAPE;
+			continue;
+		}
+
+		// Closing 7e character - the frame is complete.
+		if (decoder->length < HDLC_CRCSIZE) {
+			ERROR (decoder->context, "HDLC frame without CRC32 data");
+			return DC_STATUS_PROTOCOL;
+		}
+
+		if (decoder->length > decoder->size) {
+			ERROR (decoder->context, "HDLC frame too long (%u bytes, buffer is %u)",
+				decoder->length, decoder->size);
+			return DC_STATUS_PROTOCOL;
+		}
+
+		status = DC_STATUS_DONE;
+	}
+
+	hdlc_decoder_update_crc (decoder);
+
+	if (status == DC_STATUS_DONE) {
+		unsigned int length = decoder->length - HDLC_CRCSIZE;
+		if (decoder->crc != array_uint32_le (decoder->data + length)) {
+			ERROR (decoder->context, "HDLC frame has incorrect CRC32 data");
+			return DC_STATUS_PROTOCOL;
+		}
+
+		decoder->state = STATE_IDLE;
+
+		if (actual)
+			*actual = length;
+	}
+
+	if (consumed)
+		*consumed = offset;
+
+	return status;
+}
+
+unsigned int
+hdlc_encode (unsigned char output[], unsigned int osize, const unsigned char input[], unsigned int isize)
+{
+	unsigned char crc[HDLC_CRCSIZE];
+	unsigned int nbytes = 0;
+
+	array_uint32_le_set (crc, crc32 (crc32 (0, NULL, 0), input, isize));
+
+	if (nbytes + 1 > osize)
+		return 0;
+	output[nbytes++] = FLAG;
+
+	for (unsigned int i = 0; i < isize + HDLC_CRCSIZE; ++i) {
+		unsigned char c = i < isize ? input[i] : crc[i - isize];
+		if (c == FLAG || c == ESC) {
+			if (nbytes + 2 > osize)
+				return 0;
+			output[nbytes++] = ESC;
+			output[nbytes++] = c ^ ESCBIT;
+		} else {
+			if (nbytes + 1 > osize)
+				return 0;
+			output[nbytes++] = c;
+		}
+	}
+
+	if (nbytes + 1 > osize)
+		return 0;
+	output[nbytes++] = FLAG;
+
+	return nbytes;
+}
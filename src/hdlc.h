@@ -0,0 +1,105 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_HDLC_H
+#define DC_HDLC_H
+
+#include <libdivecomputer/common.h>
+#include <libdivecomputer/context.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * HDLC style framing, as used by several BLE dive computers. A frame
+ * starts and ends with a 0x7E flag byte, the 0x7E and 0x7D bytes inside
+ * the frame are escaped with 0x7D followed by the byte XOR'ed with 0x20,
+ * and the payload is followed by a little endian CRC32 checksum.
+ */
+
+#define HDLC_CRCSIZE 4
+
+/*
+ * The maximum size of an encoded frame with the given payload size.
+ */
+#define HDLC_ENCODED_SIZE(n) (2 + 2 * ((n) + HDLC_CRCSIZE))
+
+typedef struct hdlc_decoder_t {
+	dc_context_t *context;
+	unsigned char *data;
+	unsigned int size;
+	unsigned int length;
+	unsigned int state;
+	unsigned int crc;
+	unsigned int crclen;
+} hdlc_decoder_t;
+
+/**
+ * Initialize the decoder for a new frame.
+ *
+ * @param[in]  decoder  A valid decoder.
+ * @param[in]  context  A valid context object.
+ * @param[out] data     The buffer to decode the frame into. It needs to
+ *                      be large enough for the payload and the checksum.
+ * @param[in]  size     The size of the buffer.
+ */
+void
+hdlc_decoder_init (hdlc_decoder_t *decoder, dc_context_t *context, unsigned char data[], unsigned int size);
+
+/**
+ * Decode a chunk of the incoming byte stream. The data is unescaped
+ * directly into the output buffer, and the checksum is updated in the
+ * same pass.
+ *
+ * @param[in]  decoder   A valid decoder.
+ * @param[in]  data      The received data.
+ * @param[in]  size      The size of the received data.
+ * @param[out] consumed  The number of bytes processed. Any remaining
+ *                       bytes belong to the next frame.
+ * @param[out] actual    The size of the payload, once the frame is
+ *                       complete.
+ * @returns #DC_STATUS_DONE when the frame is complete and the checksum
+ * is correct, #DC_STATUS_SUCCESS when more data is needed, or another
+ * #dc_status_t code on failure.
+ */
+dc_status_t
+hdlc_decoder_push (hdlc_decoder_t *decoder, const unsigned char data[], unsigned int size, unsigned int *consumed, unsigned int *actual);
+
+/**
+ * Encode a frame. The payload is escaped and the checksum is appended.
+ *
+ * @param[out] output  The buffer to encode the frame into. A buffer of
+ *                     HDLC_ENCODED_SIZE(isize) bytes is always large
+ *                     enough.
+ * @param[in]  osize   The size of the output buffer.
+ * @param[in]  input   The payload.
+ * @param[in]  isize   The size of the payload.
+ * @returns The size of the encoded frame, or zero if the output buffer
+ * is too small.
+ */
+unsigned int
+hdlc_encode (unsigned char output[], unsigned int osize, const unsigned char input[], unsigned int isize);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_HDLC_H */
@@ -149,6 +149,9 @@ hw_ostc_device_open (dc_device_t **out, dc_context_t *context, const char *name)
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->iostream);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_iostream_configure (device->iostream, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -696,40 +699,10 @@ hw_ostc_firmware_readfile (hw_ostc_firmware_t *firmware, dc_context_t *context,
 		return rc;
 	}
 
-	// Read the hex file.
-	unsigned int lba = 0;
-	dc_ihex_entry_t entry;
-	while ((rc = dc_ihex_file_read (file, &entry)) == DC_STATUS_SUCCESS) {
-		if (entry.type == 0) {
-			// Data record.
-			unsigned int address = (lba << 16) + entry.address;
-			if (address + entry.length > SZ_FIRMWARE) {
-				WARNING (context, "Ignoring out of range record (0x%08x,%u).", address, entry.length);
-				continue;
-			}
-
-			// Copy the record to the buffer.
-			memcpy (firmware->data + address, entry.data, entry.length);
-
-			// Mark the corresponding blocks in the bitmap.
-			unsigned int begin = address / SZ_BLOCK;
-			unsigned int end = (address + entry.length + SZ_BLOCK - 1) / SZ_BLOCK;
-			for (unsigned int i = begin; i < end; ++i) {
-				firmware->bitmap[i] = 1;
-			}
-		} else if (entry.type == 1) {
-			// End of file record.
-			break;
-		} else if (entry.type == 4) {
-			// Extended linear address record.
-			lba = array_uint16_be (entry.data);
-		} else {
-			ERROR (context, "Unexpected record type.");
-			dc_ihex_file_close (file);
-			return DC_STATUS_DATAFORMAT;
-		}
-	}
-	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_DONE) {
+	// Load the hex file into the firmware image.
+	rc = dc_ihex_file_load (file, firmware->data, sizeof (firmware->data),
+		firmware->bitmap, SZ_BLOCK);
+	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to read the record.");
 		dc_ihex_file_close (file);
 		return rc;
@@ -860,6 +833,8 @@ hw_ostc_firmware_write (hw_ostc_device_t *device, unsigned char *data, unsigned
 		// Abort if the maximum number of retries is reached.
 		if (nretries++ >= MAXRETRIES)
 			break;
+
+		device_statistics_retry ((dc_device_t *) device);
 	}
 
 	return rc;
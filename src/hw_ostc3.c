@@ -22,15 +22,17 @@
 
 #include <string.h> // memcmp, memcpy
 #include <stdlib.h> // malloc, free
-#include <stdio.h>  // FILE, fopen
+#include <stdio.h>  // snprintf
 
 #include "hw_ostc3.h"
+#include "common-private.h"
 #include "context-private.h"
 #include "device-private.h"
 #include "serial.h"
 #include "array.h"
 #include "aes.h"
 #include "platform.h"
+#include "timer.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &hw_ostc3_device_vtable)
 
@@ -44,6 +46,7 @@
 #define SZ_FWINFO     4
 #define SZ_FIRMWARE   0x01E000        // 120KB
 #define SZ_FIRMWARE_BLOCK    0x1000   //   4KB
+#define SZ_PACKET     1024
 #define FIRMWARE_AREA      0x3E0000
 
 #define RB_LOGBOOK_SIZE_COMPACT  16
@@ -223,11 +226,12 @@ hw_ostc3_transfer (hw_ostc3_device_t *device,
 	}
 
 	if (input) {
-		// Send the input data packet.
+		// Send the input data packet. The data is only split into
+		// smaller packets to be able to report the progress.
 		unsigned int nbytes = 0;
 		while (nbytes < isize) {
-			// Set the minimum packet size.
-			unsigned int len = 64;
+			// Set the maximum packet size.
+			unsigned int len = progress ? SZ_PACKET : isize;
 
 			// Limit the packet size to the total size.
 			if (nbytes + len > isize)
@@ -254,7 +258,7 @@ hw_ostc3_transfer (hw_ostc3_device_t *device,
 		unsigned int nbytes = 0;
 		while (nbytes < osize) {
 			// Set the minimum packet size.
-			unsigned int len = 1024;
+			unsigned int len = SZ_PACKET;
 
 			// Increase the packet size if more data is immediately available.
 			size_t available = 0;
@@ -345,6 +349,9 @@ hw_ostc3_device_open (dc_device_t **out, dc_context_t *context, const char *name
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->iostream);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_iostream_configure (device->iostream, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -994,45 +1001,41 @@ hw_ostc3_firmware_checksum (const unsigned char data[], unsigned int size)
 }
 
 static dc_status_t
-hw_ostc3_firmware_readline (FILE *fp, dc_context_t *context, unsigned int addr, unsigned char data[], unsigned int size)
+hw_ostc3_firmware_readline (dc_buffer_t *buffer, size_t *offset, dc_context_t *context, unsigned int addr, unsigned char data[], unsigned int size)
 {
-	unsigned char ascii[39];
+	const unsigned char *ascii = dc_buffer_get_data (buffer);
+	size_t length = dc_buffer_get_size (buffer);
+	size_t i = *offset;
 	unsigned char faddr_byte[3];
 	unsigned int faddr = 0;
-	int n = 0;
 
 	if (size > 16) {
 		ERROR (context, "Invalid arguments.");
 		return DC_STATUS_INVALIDARGS;
 	}
 
-	// Read the start code.
-	while (1) {
-		n = fread (ascii, 1, 1, fp);
-		if (n != 1) {
-			ERROR (context, "Failed to read the start code.");
-			return DC_STATUS_IO;
-		}
+	// Find the start code, ignoring CR and LF characters.
+	while (i < length && (ascii[i] == '\n' || ascii[i] == '\r'))
+		i++;
 
-		if (ascii[0] == ':')
-			break;
+	if (i == length) {
+		ERROR (context, "Failed to read the start code.");
+		return DC_STATUS_IO;
+	}
 
-		// Ignore CR and LF characters.
-		if (ascii[0] != '\n' && ascii[0] != '\r') {
-			ERROR (context, "Unexpected character (0x%02x).", ascii[0]);
-			return DC_STATUS_DATAFORMAT;
-		}
+	if (ascii[i] != ':') {
+		ERROR (context, "Unexpected character (0x%02x).", ascii[i]);
+		return DC_STATUS_DATAFORMAT;
 	}
 
-	// Read the payload.
-	n = fread (ascii + 1, 1, 6 + size * 2, fp);
-	if (n != 6 + size * 2) {
+	// Check the payload length.
+	if (length - i < 1 + 6 + size * 2) {
 		ERROR (context, "Failed to read the data.");
 		return DC_STATUS_IO;
 	}
 
 	// Convert the address to binary representation.
-	if (array_convert_hex2bin(ascii + 1, 6, faddr_byte, sizeof(faddr_byte)) != 0) {
+	if (array_convert_hex2bin(ascii + i + 1, 6, faddr_byte, sizeof(faddr_byte)) != 0) {
 		ERROR (context, "Invalid hexadecimal character.");
 		return DC_STATUS_DATAFORMAT;
 	}
@@ -1045,11 +1048,13 @@ hw_ostc3_firmware_readline (FILE *fp, dc_context_t *context, unsigned int addr,
 	}
 
 	// Convert the payload to binary representation.
-	if (array_convert_hex2bin (ascii + 1 + 6, size * 2, data, size) != 0) {
+	if (array_convert_hex2bin (ascii + i + 1 + 6, size * 2, data, size) != 0) {
 		ERROR (context, "Invalid hexadecimal character.");
 		return DC_STATUS_DATAFORMAT;
 	}
 
+	*offset = i + 1 + 6 + size * 2;
+
 	return DC_STATUS_SUCCESS;
 }
 
@@ -1058,7 +1063,8 @@ static dc_status_t
 hw_ostc3_firmware_readfile3 (hw_ostc3_firmware_t *firmware, dc_context_t *context, const char *filename)
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
-	FILE *fp = NULL;
+	dc_buffer_t *buffer = NULL;
+	size_t offset = 0;
 	unsigned char iv[16] = {0};
 	unsigned char tmpbuf[16] = {0};
 	unsigned char encrypted[16] = {0};
@@ -1074,17 +1080,16 @@ hw_ostc3_firmware_readfile3 (hw_ostc3_firmware_t *firmware, dc_context_t *contex
 	memset (firmware->data, 0xFF, sizeof (firmware->data));
 	firmware->checksum = 0;
 
-	fp = fopen (filename, "rb");
-	if (fp == NULL) {
-		ERROR (context, "Failed to open the file.");
-		return DC_STATUS_IO;
+	// Read the entire file into memory.
+	rc = dc_file_read (&buffer, context, filename);
+	if (rc != DC_STATUS_SUCCESS) {
+		return rc;
 	}
 
-	rc = hw_ostc3_firmware_readline (fp, context, 0, iv, sizeof(iv));
+	rc = hw_ostc3_firmware_readline (buffer, &offset, context, 0, iv, sizeof(iv));
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to parse header.");
-		fclose (fp);
-		return rc;
+		goto error_free;
 	}
 	bytes += 16;
 
@@ -1092,11 +1097,10 @@ hw_ostc3_firmware_readfile3 (hw_ostc3_firmware_t *firmware, dc_context_t *contex
 	AES128_ECB_encrypt (iv, ostc3_key, tmpbuf);
 
 	for (addr = 0; addr < SZ_FIRMWARE; addr += 16, bytes += 16) {
-		rc = hw_ostc3_firmware_readline (fp, context, bytes, encrypted, sizeof(encrypted));
+		rc = hw_ostc3_firmware_readline (buffer, &offset, context, bytes, encrypted, sizeof(encrypted));
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (context, "Failed to parse file data.");
-			fclose (fp);
-			return rc;
+			goto error_free;
 		}
 
 		// Decrypt AES-FCB data
@@ -1108,14 +1112,13 @@ hw_ostc3_firmware_readfile3 (hw_ostc3_firmware_t *firmware, dc_context_t *contex
 	}
 
 	// This file format contains a tail with the checksum in
-	rc = hw_ostc3_firmware_readline (fp, context, bytes, checksum, sizeof(checksum));
+	rc = hw_ostc3_firmware_readline (buffer, &offset, context, bytes, checksum, sizeof(checksum));
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to parse file tail.");
-		fclose (fp);
-		return rc;
+		goto error_free;
 	}
 
-	fclose (fp);
+	dc_buffer_free (buffer);
 
 	unsigned int csum1 = array_uint32_le (checksum);
 	unsigned int csum2 = hw_ostc3_firmware_checksum (firmware->data, sizeof(firmware->data));
@@ -1127,39 +1130,15 @@ hw_ostc3_firmware_readfile3 (hw_ostc3_firmware_t *firmware, dc_context_t *contex
 	firmware->checksum = csum1;
 
 	return DC_STATUS_SUCCESS;
+
+error_free:
+	dc_buffer_free (buffer);
+	return rc;
 }
 
 static dc_status_t
-hw_ostc3_firmware_readfile4 (dc_buffer_t *buffer, dc_context_t *context, const char *filename)
+hw_ostc3_firmware_verify4 (dc_buffer_t *buffer, dc_context_t *context)
 {
-	FILE *fp = NULL;
-
-	if (buffer == NULL) {
-		ERROR (context, "Invalid arguments.");
-		return DC_STATUS_INVALIDARGS;
-	}
-
-	// Open the file.
-	fp = fopen (filename, "rb");
-	if (fp == NULL) {
-		ERROR (context, "Failed to open the file.");
-		return DC_STATUS_IO;
-	}
-
-	// Read the entire file into the buffer.
-	size_t n = 0;
-	unsigned char block[1024] = {0};
-	while ((n = fread (block, 1, sizeof (block), fp)) > 0) {
-		if (!dc_buffer_append (buffer, block, n)) {
-			ERROR (context, "Insufficient buffer space available.");
-			fclose (fp);
-			return DC_STATUS_NOMEMORY;
-		}
-	}
-
-	// Close the file.
-	fclose (fp);
-
 	// Verify the minimum size.
 	size_t size = dc_buffer_get_size (buffer);
 	if (size < 4) {
@@ -1297,7 +1276,11 @@ hw_ostc3_device_fwupdate3 (dc_device_t *abstract, const char *filename)
 
 	hw_ostc3_device_display (abstract, " Uploading...");
 
+	// Each block is verified immediately after it has been written. The
+	// device only validates the image checksum after the reboot, without
+	// reporting the result back, so the read-back can't be skipped.
 	for (unsigned int len = 0; len < SZ_FIRMWARE; len += SZ_FIRMWARE_BLOCK) {
+		unsigned char block[SZ_FIRMWARE_BLOCK];
 		char status[SZ_DISPLAY + 1]; // Status message on the display
 		snprintf (status, sizeof(status), " Uploading %2d%%", (100 * len) / SZ_FIRMWARE);
 		hw_ostc3_device_display (abstract, status);
@@ -1311,15 +1294,6 @@ hw_ostc3_device_fwupdate3 (dc_device_t *abstract, const char *filename)
 		// One block uploaded
 		progress.current++;
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
-	}
-
-	hw_ostc3_device_display (abstract, " Verifying...");
-
-	for (unsigned int len = 0; len < SZ_FIRMWARE; len += SZ_FIRMWARE_BLOCK) {
-		unsigned char block[SZ_FIRMWARE_BLOCK];
-		char status[SZ_DISPLAY + 1]; // Status message on the display
-		snprintf (status, sizeof(status), " Verifying %2d%%", (100 * len) / SZ_FIRMWARE);
-		hw_ostc3_device_display (abstract, status);
 
 		rc = hw_ostc3_firmware_block_read (device, FIRMWARE_AREA + len, block, sizeof (block));
 		if (rc != DC_STATUS_SUCCESS) {
@@ -1364,16 +1338,15 @@ hw_ostc3_device_fwupdate4 (dc_device_t *abstract, const char *filename)
 	hw_ostc3_device_t *device = (hw_ostc3_device_t *) abstract;
 	dc_context_t *context = (abstract ? abstract->context : NULL);
 
-	// Allocate memory for the firmware data.
-	dc_buffer_t *buffer = dc_buffer_new (0);
-	if (buffer == NULL) {
-		ERROR (context, "Failed to allocate memory.");
-		status = DC_STATUS_NOMEMORY;
+	// Read the firmware file.
+	dc_buffer_t *buffer = NULL;
+	status = dc_file_read (&buffer, context, filename);
+	if (status != DC_STATUS_SUCCESS) {
 		goto error;
 	}
 
-	// Read the firmware file.
-	status = hw_ostc3_firmware_readfile4 (buffer, context, filename);
+	// Verify the firmware file.
+	status = hw_ostc3_firmware_verify4 (buffer, context);
 	if (status != DC_STATUS_SUCCESS) {
 		goto error;
 	}
@@ -1466,11 +1439,26 @@ hw_ostc3_device_fwupdate (dc_device_t *abstract, const char *filename)
 		return status;
 	}
 
+	// Measure the total update time.
+	dc_timer_t *timer = NULL;
+	dc_usecs_t elapsed = 0;
+	dc_timer_new (&timer);
+
 	if (device->hardware == OSTC4) {
-		return hw_ostc3_device_fwupdate4 (abstract, filename);
+		status = hw_ostc3_device_fwupdate4 (abstract, filename);
 	} else {
-		return hw_ostc3_device_fwupdate3 (abstract, filename);
+		status = hw_ostc3_device_fwupdate3 (abstract, filename);
+	}
+
+	if (status == DC_STATUS_SUCCESS && dc_timer_now (timer, &elapsed) == DC_STATUS_SUCCESS) {
+		INFO (abstract->context, "Firmware update: %u.%03u seconds",
+			(unsigned int) (elapsed / 1000000),
+			(unsigned int) (elapsed / 1000 % 1000));
 	}
+
+	dc_timer_free (timer);
+
+	return status;
 }
 
 static dc_status_t
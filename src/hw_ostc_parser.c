@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
@@ -37,6 +38,8 @@
 
 #define ISINSTANCE(parser) dc_parser_isinstance((parser), &hw_ostc_parser_vtable)
 
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
 #define MAXCONFIG 7
 #define NGASMIXES 15
 
@@ -79,6 +82,7 @@ typedef struct hw_ostc_sample_info_t {
 	unsigned int type;
 	unsigned int divisor;
 	unsigned int size;
+	unsigned int mask;
 } hw_ostc_sample_info_t;
 
 typedef struct hw_ostc_layout_t {
@@ -675,6 +679,25 @@ hw_ostc_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned
 }
 
 
+static unsigned int
+hw_ostc_sample_mask (unsigned int type)
+{
+	switch (type) {
+	case 0: // Temperature
+		return DC_SAMPLE_MASK (DC_SAMPLE_TEMPERATURE);
+	case 1: // Deco / NDL
+		return DC_SAMPLE_MASK (DC_SAMPLE_DECO);
+	case 3: // ppO2
+		return DC_SAMPLE_MASK (DC_SAMPLE_PPO2);
+	case 5: // CNS
+		return DC_SAMPLE_MASK (DC_SAMPLE_CNS);
+	case 6: // Tank pressure
+		return DC_SAMPLE_MASK (DC_SAMPLE_PRESSURE);
+	default: // Not yet used.
+		return 0;
+	}
+}
+
 static dc_status_t
 hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
 {
@@ -752,6 +775,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 			info[i].divisor = (data[37 + i] & 0x0F);
 			info[i].size    = (data[37 + i] & 0xF0) >> 4;
 		}
+		info[i].mask = hw_ostc_sample_mask (info[i].type);
 
 		if (info[i].divisor) {
 			switch (info[i].type) {
@@ -789,6 +813,9 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 		firmware = array_uint16_be (data + layout->firmware);
 	}
 
+	// Get the requested sample types.
+	unsigned int mask = callback ? abstract->activemask : 0;
+
 	unsigned int time = 0;
 	unsigned int nsamples = 0;
 	unsigned int tank = parser->initial != UNDEFINED ? parser->initial : 0;
@@ -796,38 +823,59 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 	unsigned int offset = header;
 	if (version == 0x23 || version == 0x24)
 		offset += 5 + 3 * nconfig;
+
+	// Resume from the seek index.
+	unsigned int end = callback ? abstract->end : UINT_MAX;
+	const dc_parser_checkpoint_t *checkpoint = callback ? dc_parser_checkpoint_find (abstract) : NULL;
+	if (checkpoint) {
+		time = checkpoint->time;
+		offset = checkpoint->offset;
+		nsamples = checkpoint->state[0];
+		tank = checkpoint->state[1];
+	}
+
 	while (offset + 3 <= size) {
 		dc_sample_value_t sample = {0};
 
+		// Stop after the requested time window. The profile was already
+		// validated by the pass that built the seek index.
+		if (time >= end)
+			return DC_STATUS_SUCCESS;
+
+		const unsigned int state[] = {nsamples, tank};
+		dc_parser_checkpoint_add (abstract, time, offset, state, C_ARRAY_SIZE (state));
+
 		nsamples++;
 
 		// Time (seconds).
 		time += samplerate;
 		sample.time = time;
-		if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
+		if (mask & DC_SAMPLE_MASK (DC_SAMPLE_TIME)) callback (DC_SAMPLE_TIME, sample, userdata);
 
 		// Initial gas mix.
 		if (time == samplerate && parser->initial != UNDEFINED) {
 			sample.gasmix = parser->initial;
-			if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
+			if (mask & DC_SAMPLE_MASK (DC_SAMPLE_GASMIX)) callback (DC_SAMPLE_GASMIX, sample, userdata);
 		}
 
 		// Initial setpoint (mbar).
 		if (time == samplerate && parser->initial_setpoint != UNDEFINED) {
 			sample.setpoint = parser->initial_setpoint / 100.0;
-			if (callback) callback (DC_SAMPLE_SETPOINT, sample, userdata);
+			if (mask & DC_SAMPLE_MASK (DC_SAMPLE_SETPOINT)) callback (DC_SAMPLE_SETPOINT, sample, userdata);
 		}
 
 		// Initial CNS (%).
 		if (time == samplerate && parser->initial_cns != UNDEFINED) {
 			sample.cns = parser->initial_cns / 100.0;
-			if (callback) callback (DC_SAMPLE_CNS, sample, userdata);
+			if (mask & DC_SAMPLE_MASK (DC_SAMPLE_CNS)) callback (DC_SAMPLE_CNS, sample, userdata);
 		}
 
 		// Depth (mbar).
-		unsigned int depth = array_uint16_le (data + offset);
-		sample.depth = (depth * BAR / 1000.0) / hydrostatic;
-		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
+		if (mask & DC_SAMPLE_MASK (DC_SAMPLE_DEPTH)) {
+			unsigned int depth = array_uint16_le (data + offset);
+			sample.depth = (depth * BAR / 1000.0) / hydrostatic;
+			callback (DC_SAMPLE_DEPTH, sample, userdata);
+		}
 		offset += 2;
 
 		// Extended sample info.
@@ -885,7 +933,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 		case 7: // Low Battery
 			break;
 		}
-		if (sample.event.type && callback)
+		if (sample.event.type && (mask & DC_SAMPLE_MASK (DC_SAMPLE_EVENT)))
 			callback (DC_SAMPLE_EVENT, sample, userdata);
 
 		// Manual Gas Set & Change
@@ -908,7 +956,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 			}
 
 			sample.gasmix = idx;
-			if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
+			if (mask & DC_SAMPLE_MASK (DC_SAMPLE_GASMIX)) callback (DC_SAMPLE_GASMIX, sample, userdata);
 			offset += 2;
 			length -= 2;
 		}
@@ -926,7 +974,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 			}
 			idx--; /* Convert to a zero based index. */
 			sample.gasmix = idx;
-			if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
+			if (mask & DC_SAMPLE_MASK (DC_SAMPLE_GASMIX)) callback (DC_SAMPLE_GASMIX, sample, userdata);
 			tank = idx;
 			offset++;
 			length--;
@@ -940,7 +988,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 					return DC_STATUS_DATAFORMAT;
 				}
 				sample.setpoint = data[offset] / 100.0;
-				if (callback) callback (DC_SAMPLE_SETPOINT, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_SETPOINT)) callback (DC_SAMPLE_SETPOINT, sample, userdata);
 				offset++;
 				length--;
 			}
@@ -966,7 +1014,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 				}
 
 				sample.gasmix = idx;
-				if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_GASMIX)) callback (DC_SAMPLE_GASMIX, sample, userdata);
 				offset += 2;
 				length -= 2;
 			}
@@ -980,6 +1028,13 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 					return DC_STATUS_DATAFORMAT;
 				}
 
+				// Skip the unwanted sample types.
+				if ((mask & info[i].mask) == 0) {
+					offset += info[i].size;
+					length -= info[i].size;
+					continue;
+				}
+
 				unsigned int ppo2[3] = {0};
 				unsigned int count = 0;
 				unsigned int value = 0;
@@ -987,7 +1042,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 				case 0: // Temperature (0.1 °C).
 					value = array_uint16_le (data + offset);
 					sample.temperature = value / 10.0;
-					if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
+					if (mask & DC_SAMPLE_MASK (DC_SAMPLE_TEMPERATURE)) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 					break;
 				case 1: // Deco / NDL
 					// Due to a firmware bug, the deco/ndl info is incorrect for
@@ -1002,7 +1057,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 						sample.deco.depth = 0.0;
 					}
 					sample.deco.time = data[offset + 1] * 60;
-					if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
+					if (mask & DC_SAMPLE_MASK (DC_SAMPLE_DECO)) callback (DC_SAMPLE_DECO, sample, userdata);
 					break;
 				case 3: // ppO2 (0.01 bar).
 					for (unsigned int j = 0; j < 3; ++j) {
@@ -1017,7 +1072,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 					if (count) {
 						for (unsigned int j = 0; j < 3; ++j) {
 							sample.ppo2 = ppo2[j] / 100.0;
-							if (callback) callback (DC_SAMPLE_PPO2, sample, userdata);
+							if (mask & DC_SAMPLE_MASK (DC_SAMPLE_PPO2)) callback (DC_SAMPLE_PPO2, sample, userdata);
 						}
 					}
 					break;
@@ -1026,13 +1081,13 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 						sample.cns = array_uint16_le (data + offset) / 100.0;
 					else
 						sample.cns = data[offset] / 100.0;
-					if (callback) callback (DC_SAMPLE_CNS, sample, userdata);
+					if (mask & DC_SAMPLE_MASK (DC_SAMPLE_CNS)) callback (DC_SAMPLE_CNS, sample, userdata);
 					break;
 				case 6: // Tank pressure
 					value = array_uint16_le (data + offset);
 					sample.pressure.tank = tank;
 					sample.pressure.value = value / 10.0;
-					if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
+					if (mask & DC_SAMPLE_MASK (DC_SAMPLE_PRESSURE)) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 					break;
 				default: // Not yet used.
 					break;
@@ -1051,7 +1106,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 					return DC_STATUS_DATAFORMAT;
 				}
 				sample.setpoint = data[offset] / 100.0;
-				if (callback) callback (DC_SAMPLE_SETPOINT, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_SETPOINT)) callback (DC_SAMPLE_SETPOINT, sample, userdata);
 				offset++;
 				length--;
 			}
@@ -1077,7 +1132,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 				}
 
 				sample.gasmix = idx;
-				if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_GASMIX)) callback (DC_SAMPLE_GASMIX, sample, userdata);
 				offset += 2;
 				length -= 2;
 			}
@@ -22,21 +22,26 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
+
+#include <libdivecomputer/buffer.h>
 
 #include "ihex.h"
+#include "common-private.h"
 #include "context-private.h"
 #include "checksum.h"
 #include "array.h"
 
 struct dc_ihex_file_t {
 	dc_context_t *context;
-	FILE *fp;
+	dc_buffer_t *buffer;
+	size_t offset;
+	unsigned char record[4 + 255 + 1];
 };
 
 dc_status_t
 dc_ihex_file_open (dc_ihex_file_t **result, dc_context_t *context, const char *filename)
 {
+	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_ihex_file_t *file = NULL;
 
 	if (result == NULL || filename == NULL) {
@@ -51,98 +56,87 @@ dc_ihex_file_open (dc_ihex_file_t **result, dc_context_t *context, const char *f
 	}
 
 	file->context = context;
+	file->offset = 0;
 
-	file->fp = fopen (filename, "rb");
-	if (file->fp == NULL) {
-		ERROR (context, "Failed to open the file.");
-		free (file);
-		return DC_STATUS_IO;
+	/* The records are parsed directly from the file contents. */
+	status = dc_file_read (&file->buffer, context, filename);
+	if (status != DC_STATUS_SUCCESS) {
+		goto error_free;
 	}
 
 	*result = file;
 
 	return DC_STATUS_SUCCESS;
+
+error_free:
+	free (file);
+	return status;
 }
 
-dc_status_t
-dc_ihex_file_read (dc_ihex_file_t *file, dc_ihex_entry_t *entry)
+/*
+ * Parse the next record into the internal record buffer. On success,
+ * the record contains the length, address, type, payload and checksum
+ * bytes, exactly as they are stored in the file.
+ */
+static dc_status_t
+dc_ihex_file_next (dc_ihex_file_t *file)
 {
-	unsigned char ascii[9 + 2 * 255 + 2] = {0};
-	unsigned char data[4 + 255 + 1] = {0};
+	const unsigned char *data = dc_buffer_get_data (file->buffer);
+	size_t size = dc_buffer_get_size (file->buffer);
+	size_t offset = file->offset;
 	unsigned int type, length, address;
 	unsigned char csum_a, csum_b;
-	size_t n;
 
-	if (file == NULL || entry == NULL) {
-		ERROR (file ? file->context : NULL, "Invalid arguments.");
-		return DC_STATUS_INVALIDARGS;
-	}
-
-	/* Read the start code. */
-	while (1) {
-		n = fread (ascii, 1, 1, file->fp);
-		if (n != 1) {
-			if (feof (file->fp)) {
-				return DC_STATUS_DONE;
-			} else {
-				ERROR (file->context, "Failed to read the start code.");
-				return DC_STATUS_IO;
-			}
-		}
+	/* Find the start code, ignoring CR and LF characters. */
+	while (offset < size && (data[offset] == '\n' || data[offset] == '\r'))
+		offset++;
 
-		if (ascii[0] == ':')
-			break;
+	if (offset == size)
+		return DC_STATUS_DONE;
 
-		/* Ignore CR and LF characters. */
-		if (ascii[0] != '\n' && ascii[0] != '\r') {
-			ERROR (file->context, "Unexpected character (0x%02x).", ascii[0]);
-			return DC_STATUS_DATAFORMAT;
-		}
+	if (data[offset] != ':') {
+		ERROR (file->context, "Unexpected character (0x%02x).", data[offset]);
+		return DC_STATUS_DATAFORMAT;
 	}
 
-	/* Read the record length, address and type. */
-	n = fread (ascii + 1, 1, 8, file->fp);
-	if (n != 8) {
+	/* Get the record length. */
+	if (size - offset < 1 + 2 * 5) {
 		ERROR (file->context, "Failed to read the header.");
 		return DC_STATUS_IO;
 	}
 
-	/* Convert to binary representation. */
-	if (array_convert_hex2bin (ascii + 1, 8, data, 4) != 0) {
+	if (array_convert_hex2bin (data + offset + 1, 2, file->record, 1) != 0) {
 		ERROR (file->context, "Invalid hexadecimal character.");
 		return DC_STATUS_DATAFORMAT;
 	}
 
-	/* Get the record length. */
-	length = data[0];
+	length = file->record[0];
 
-	/* Read the record payload. */
-	n = fread (ascii + 9, 1, 2 * length + 2, file->fp);
-	if (n != 2 * length + 2) {
+	/* Convert the entire record to binary representation. */
+	if (size - offset < 1 + 2 * (length + 5)) {
 		ERROR (file->context, "Failed to read the data.");
 		return DC_STATUS_IO;
 	}
 
-	/* Convert to binary representation. */
-	if (array_convert_hex2bin (ascii + 9, 2 * length + 2, data + 4, length + 1) != 0) {
+	if (array_convert_hex2bin (data + offset + 1, 2 * (length + 5), file->record, length + 5) != 0) {
 		ERROR (file->context, "Invalid hexadecimal character.");
 		return DC_STATUS_DATAFORMAT;
 	}
 
 	/* Verify the checksum. */
-	csum_a = data[4 + length];
-	csum_b = ~checksum_add_uint8 (data, 4 + length, 0x00) + 1;
+	csum_a = file->record[4 + length];
+	csum_b = ~checksum_add_uint8 (file->record, 4 + length, 0x00) + 1;
 	if (csum_a != csum_b) {
 		ERROR (file->context, "Unexpected checksum (0x%02x, 0x%02x).", csum_a, csum_b);
 		return DC_STATUS_DATAFORMAT;
 	}
 
 	/* Get the record address. */
-	address = array_uint16_be (data + 1);
+	address = array_uint16_be (file->record + 1);
 
 	/* Get the record type. */
-	type = data[3];
-	if (type < 0 || type > 5) {
+	type = file->record[3];
+	if (type > 5) {
 		ERROR (file->context, "Invalid record type (0x%02x).", type);
 		return DC_STATUS_DATAFORMAT;
 	}
@@ -169,18 +163,95 @@ dc_ihex_file_read (dc_ihex_file_t *file, dc_ihex_entry_t *entry)
 		}
 	}
 
+	file->offset = offset + 1 + 2 * (length + 5);
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_ihex_file_read (dc_ihex_file_t *file, dc_ihex_entry_t *entry)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (file == NULL || entry == NULL) {
+		ERROR (file ? file->context : NULL, "Invalid arguments.");
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	status = dc_ihex_file_next (file);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
 	/* Set the record fields. */
-	entry->type = type;
-	entry->address = address;
-	entry->length = length;
+	entry->type = file->record[3];
+	entry->address = array_uint16_be (file->record + 1);
+	entry->length = file->record[0];
 
 	/* Copy the record data. */
-	memcpy (entry->data, data + 4, entry->length);
+	memcpy (entry->data, file->record + 4, entry->length);
 	memset (entry->data + entry->length, 0, sizeof (entry->data) - entry->length);
 
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_ihex_file_load (dc_ihex_file_t *file, unsigned char data[], unsigned int size, unsigned char bitmap[], unsigned int blocksize)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	unsigned int base = 0;
+
+	if (file == NULL || data == NULL || (bitmap && blocksize == 0)) {
+		ERROR (file ? file->context : NULL, "Invalid arguments.");
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	while ((status = dc_ihex_file_next (file)) == DC_STATUS_SUCCESS) {
+		unsigned int length = file->record[0];
+		unsigned int type = file->record[3];
+		const unsigned char *payload = file->record + 4;
+
+		if (type == 0) {
+			/* Data record. */
+			unsigned int address = base + array_uint16_be (file->record + 1);
+			if (address > size || length > size - address) {
+				WARNING (file->context, "Ignoring out of range record (0x%08x,%u).", address, length);
+				continue;
+			}
+
+			/* Copy the record to the image. */
+			memcpy (data + address, payload, length);
+
+			/* Mark the corresponding blocks in the bitmap. */
+			if (bitmap) {
+				unsigned int begin = address / blocksize;
+				unsigned int end = (address + length + blocksize - 1) / blocksize;
+				memset (bitmap + begin, 1, end - begin);
+			}
+		} else if (type == 1) {
+			/* End of file record. */
+			return DC_STATUS_SUCCESS;
+		} else if (type == 2 || type == 4) {
+			/* Extended segment or linear address record. */
+			if (length != 2) {
+				ERROR (file->context, "Invalid record length (%u).", length);
+				return DC_STATUS_DATAFORMAT;
+			}
+			base = array_uint16_be (payload) << (type == 2 ? 4 : 16);
+		} else if (type == 3 || type == 5) {
+			/* The start address records are not needed. */
+		} else {
+			ERROR (file->context, "Unexpected record type (0x%02x).", type);
+			return DC_STATUS_DATAFORMAT;
+		}
+	}
+
+	if (status != DC_STATUS_DONE) {
+		return status;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
 dc_status_t
 dc_ihex_file_reset (dc_ihex_file_t *file)
 {
@@ -189,7 +260,7 @@ dc_ihex_file_reset (dc_ihex_file_t *file)
 		return DC_STATUS_INVALIDARGS;
 	}
 
-	rewind (file->fp);
+	file->offset = 0;
 
 	return DC_STATUS_SUCCESS;
 }
@@ -198,7 +269,7 @@ dc_status_t
 dc_ihex_file_close (dc_ihex_file_t *file)
 {
 	if (file) {
-		fclose (file->fp);
+		dc_buffer_free (file->buffer);
 		free (file);
 	}
 
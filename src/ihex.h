@@ -44,6 +44,14 @@ dc_ihex_file_open (dc_ihex_file_t **file, dc_context_t *context, const char *fil
 dc_status_t
 dc_ihex_file_read (dc_ihex_file_t *file, dc_ihex_entry_t *entry);
 
+/*
+ * Load all remaining data records into a memory image. Records outside
+ * the image are ignored. If a bitmap is supplied, the blocks (of the
+ * given size) that contain any data are marked with a non-zero value.
+ */
+dc_status_t
+dc_ihex_file_load (dc_ihex_file_t *file, unsigned char data[], unsigned int size, unsigned char bitmap[], unsigned int blocksize);
+
 dc_status_t
 dc_ihex_file_reset (dc_ihex_file_t *file);
 
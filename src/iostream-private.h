@@ -25,6 +25,10 @@
 #include <libdivecomputer/common.h>
 #include <libdivecomputer/context.h>
 #include <libdivecomputer/iostream.h>
+#include <libdivecomputer/device.h>
+
+#include "timer.h"
+#include "capture.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,6 +39,23 @@ typedef struct dc_iostream_vtable_t dc_iostream_vtable_t;
 struct dc_iostream_t {
 	const dc_iostream_vtable_t *vtable;
 	dc_context_t *context;
+	// Transfer statistics.
+	dc_statistics_t *statistics;
+	dc_timer_t *timer;
+	unsigned int written;
+	// Round-trip time estimator.
+	unsigned int adaptive;
+	int timeout;
+	int effective;
+	unsigned int exchange;
+	dc_usecs_t exchange_begin;
+	dc_usecs_t exchange_end;
+	unsigned int nsamples;
+	double srtt;
+	double rttvar;
+	unsigned int backoff;
+	// I/O capture file.
+	dc_capture_t *capture;
 };
 
 struct dc_iostream_vtable_t {
@@ -78,6 +99,29 @@ dc_iostream_deallocate (dc_iostream_t *iostream);
 int
 dc_iostream_isinstance (dc_iostream_t *iostream, const dc_iostream_vtable_t *vtable);
 
+/*
+ * Enable or disable the adaptive timeout.
+ *
+ * The time between the first write of a request and the last read of
+ * its answer is measured for every exchange, and smoothed the same way
+ * as the TCP retransmission timer (RFC 6298). With the adaptive timeout
+ * enabled, each read uses a timeout of a few multiples of the measured
+ * round-trip time, doubled after every timeout, instead of the timeout
+ * set with dc_iostream_set_timeout(). That timeout remains the upper
+ * limit, and is also used as long as there are no measurements yet.
+ *
+ * Only useful for drivers that retry a request after a timeout.
+ */
+dc_status_t
+dc_iostream_set_adaptive (dc_iostream_t *iostream, unsigned int value);
+
+/*
+ * Collect the transfer statistics of the I/O stream in the given
+ * counters, typically those of the device that owns the stream.
+ */
+dc_status_t
+dc_iostream_set_statistics (dc_iostream_t *iostream, dc_statistics_t *statistics);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
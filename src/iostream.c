@@ -25,6 +25,15 @@
 
 #include "iostream-private.h"
 #include "context-private.h"
+#include "array.h"
+
+#define RTO_MIN         100 /* Milliseconds */
+#define RTO_GRANULARITY 10  /* Milliseconds */
+#define RTO_MAXBACKOFF  6
+
+#define EXCHANGE_NONE     0
+#define EXCHANGE_REQUEST  1
+#define EXCHANGE_ANSWER   2
 
 dc_iostream_t *
 dc_iostream_allocate (dc_context_t *context, const dc_iostream_vtable_t *vtable)
@@ -45,12 +54,46 @@ dc_iostream_allocate (dc_context_t *context, const dc_iostream_vtable_t *vtable)
 	iostream->vtable = vtable;
 	iostream->context = context;
 
+	iostream->statistics = NULL;
+	iostream->timer = NULL;
+	iostream->written = 0;
+	dc_timer_new (&iostream->timer);
+
+	iostream->adaptive = 0;
+	iostream->timeout = -1;
+	iostream->effective = -1;
+	iostream->exchange = EXCHANGE_NONE;
+	iostream->exchange_begin = 0;
+	iostream->exchange_end = 0;
+	iostream->nsamples = 0;
+	iostream->srtt = 0.0;
+	iostream->rttvar = 0.0;
+	iostream->backoff = 0;
+
+	iostream->capture = _dc_context_capture (context);
+
 	return iostream;
 }
 
+static void
+dc_iostream_capture (dc_iostream_t *iostream, dc_capture_type_t type, dc_status_t status, unsigned int value)
+{
+	unsigned char data[4] = {0};
+
+	if (iostream->capture == NULL)
+		return;
+
+	array_uint32_le_set (data, value);
+	dc_capture_record (iostream->capture, type, status, data, sizeof (data));
+}
+
 void
 dc_iostream_deallocate (dc_iostream_t *iostream)
 {
+	if (iostream == NULL)
+		return;
+
+	dc_timer_free (iostream->timer);
 	free (iostream);
 }
 
@@ -63,89 +106,283 @@ dc_iostream_isinstance (dc_iostream_t *iostream, const dc_iostream_vtable_t *vta
 	return iostream->vtable == vtable;
 }
 
+static void
+dc_iostream_rtt_sample (dc_iostream_t *iostream, double rtt)
+{
+	// Update the smoothed round-trip time and its variation.
+	if (iostream->nsamples == 0) {
+		iostream->srtt = rtt;
+		iostream->rttvar = rtt / 2;
+	} else {
+		double delta = iostream->srtt > rtt ? iostream->srtt - rtt : rtt - iostream->srtt;
+		iostream->rttvar = 0.75 * iostream->rttvar + 0.25 * delta;
+		iostream->srtt = 0.875 * iostream->srtt + 0.125 * rtt;
+	}
+
+	iostream->nsamples++;
+	iostream->backoff = 0;
+
+	if (iostream->statistics) {
+		iostream->statistics->rtt = iostream->srtt / 1000.0;
+		iostream->statistics->rtt_variation = iostream->rttvar / 1000.0;
+	}
+}
+
+static void
+dc_iostream_rtt_adapt (dc_iostream_t *iostream)
+{
+	// The timeouts are not replayed.
+	if (iostream->vtable->set_timeout == NULL || dc_capture_isreplay (iostream->capture))
+		return;
+
+	int timeout = iostream->timeout;
+	if (iostream->adaptive && iostream->nsamples && timeout > 0) {
+		double variation = 4 * iostream->rttvar;
+		if (variation < RTO_GRANULARITY)
+			variation = RTO_GRANULARITY;
+
+		double rto = iostream->srtt + variation;
+		if (rto < RTO_MIN)
+			rto = RTO_MIN;
+		rto *= 1 << iostream->backoff;
+
+		// Round up to the granularity, to avoid changing the
+		// timeout after every single measurement.
+		if (rto < timeout) {
+			timeout = ((unsigned int) rto / RTO_GRANULARITY + 1) * RTO_GRANULARITY;
+			if (timeout > iostream->timeout)
+				timeout = iostream->timeout;
+		}
+	}
+
+	if (timeout == iostream->effective)
+		return;
+
+	if (iostream->vtable->set_timeout (iostream, timeout) != DC_STATUS_SUCCESS)
+		return;
+
+	DEBUG (iostream->context, "Timeout: value=%i (adaptive)", timeout);
+
+	iostream->effective = timeout;
+	if (iostream->statistics && timeout > 0) {
+		iostream->statistics->timeout = timeout / 1000.0;
+	}
+}
+
+dc_status_t
+dc_iostream_set_adaptive (dc_iostream_t *iostream, unsigned int value)
+{
+	if (iostream == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	iostream->adaptive = value;
+
+	// Restore the original timeout.
+	if (!value) {
+		dc_iostream_rtt_adapt (iostream);
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_iostream_set_statistics (dc_iostream_t *iostream, dc_statistics_t *statistics)
+{
+	if (iostream == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	iostream->statistics = statistics;
+
+	return DC_STATUS_SUCCESS;
+}
+
 dc_status_t
 dc_iostream_set_timeout (dc_iostream_t *iostream, int timeout)
 {
-	if (iostream == NULL || iostream->vtable->set_timeout == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	INFO (iostream->context, "Timeout: value=%i", timeout);
 
-	return iostream->vtable->set_timeout (iostream, timeout);
+	if (iostream->vtable->set_timeout == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->set_timeout (iostream, timeout);
+	}
+
+	if (status == DC_STATUS_SUCCESS) {
+		iostream->timeout = timeout;
+		iostream->effective = timeout;
+		if (iostream->statistics && timeout > 0) {
+			iostream->statistics->timeout = timeout / 1000.0;
+		}
+	}
+
+	dc_iostream_capture (iostream, DC_CAPTURE_SET_TIMEOUT, status, timeout);
+
+	return status;
 }
 
 dc_status_t
 dc_iostream_set_latency (dc_iostream_t *iostream, unsigned int value)
 {
-	if (iostream == NULL || iostream->vtable->set_latency == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	INFO (iostream->context, "Latency: value=%i", value);
 
-	return iostream->vtable->set_latency (iostream, value);
+	if (iostream->vtable->set_latency == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->set_latency (iostream, value);
+	}
+
+	dc_iostream_capture (iostream, DC_CAPTURE_SET_LATENCY, status, value);
+
+	return status;
 }
 
 dc_status_t
 dc_iostream_set_break (dc_iostream_t *iostream, unsigned int value)
 {
-	if (iostream == NULL || iostream->vtable->set_break == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	INFO (iostream->context, "Break: value=%i", value);
 
-	return iostream->vtable->set_break (iostream, value);
+	if (iostream->vtable->set_break == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->set_break (iostream, value);
+	}
+
+	dc_iostream_capture (iostream, DC_CAPTURE_SET_BREAK, status, value);
+
+	return status;
 }
 
 dc_status_t
 dc_iostream_set_dtr (dc_iostream_t *iostream, unsigned int value)
 {
-	if (iostream == NULL || iostream->vtable->set_dtr == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	INFO (iostream->context, "DTR: value=%i", value);
 
-	return iostream->vtable->set_dtr (iostream, value);
+	if (iostream->vtable->set_dtr == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->set_dtr (iostream, value);
+	}
+
+	dc_iostream_capture (iostream, DC_CAPTURE_SET_DTR, status, value);
+
+	return status;
 }
 
 dc_status_t
 dc_iostream_set_rts (dc_iostream_t *iostream, unsigned int value)
 {
-	if (iostream == NULL || iostream->vtable->set_rts == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	INFO (iostream->context, "RTS: value=%i", value);
 
-	return iostream->vtable->set_rts (iostream, value);
+	if (iostream->vtable->set_rts == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->set_rts (iostream, value);
+	}
+
+	dc_iostream_capture (iostream, DC_CAPTURE_SET_RTS, status, value);
+
+	return status;
 }
 
 dc_status_t
 dc_iostream_get_lines (dc_iostream_t *iostream, unsigned int *value)
 {
-	if (iostream == NULL || iostream->vtable->get_lines == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+	unsigned int lines = 0;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return iostream->vtable->get_lines (iostream, value);
+	if (iostream->vtable->get_lines == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->get_lines (iostream, &lines);
+	}
+
+	dc_iostream_capture (iostream, DC_CAPTURE_GET_LINES, status, lines);
+
+	if (value)
+		*value = lines;
+
+	return status;
 }
 
 dc_status_t
 dc_iostream_get_available (dc_iostream_t *iostream, size_t *value)
 {
-	if (iostream == NULL || iostream->vtable->get_available == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t available = 0;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return iostream->vtable->get_available (iostream, value);
+	if (iostream->vtable->get_available == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->get_available (iostream, &available);
+	}
+
+	dc_iostream_capture (iostream, DC_CAPTURE_GET_AVAILABLE, status, available);
+
+	if (value)
+		*value = available;
+
+	return status;
 }
 
 dc_status_t
 dc_iostream_configure (dc_iostream_t *iostream, unsigned int baudrate, unsigned int databits, dc_parity_t parity, dc_stopbits_t stopbits, dc_flowcontrol_t flowcontrol)
 {
-	if (iostream == NULL || iostream->vtable->configure == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	INFO (iostream->context, "Configure: baudrate=%i, databits=%i, parity=%i, stopbits=%i, flowcontrol=%i",
 		baudrate, databits, parity, stopbits, flowcontrol);
 
-	return iostream->vtable->configure (iostream, baudrate, databits, parity, stopbits, flowcontrol);
+	if (iostream->vtable->configure == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->configure (iostream, baudrate, databits, parity, stopbits, flowcontrol);
+	}
+
+	if (iostream->capture) {
+		unsigned char settings[5 * 4] = {0};
+		array_uint32_le_set (settings +  0, baudrate);
+		array_uint32_le_set (settings +  4, databits);
+		array_uint32_le_set (settings +  8, parity);
+		array_uint32_le_set (settings + 12, stopbits);
+		array_uint32_le_set (settings + 16, flowcontrol);
+		dc_capture_record (iostream->capture, DC_CAPTURE_CONFIGURE, status, settings, sizeof (settings));
+	}
+
+	return status;
 }
 
 dc_status_t
@@ -159,8 +396,45 @@ dc_iostream_read (dc_iostream_t *iostream, void *data, size_t size, size_t *actu
 		goto out;
 	}
 
+	if (iostream->adaptive)
+		dc_iostream_rtt_adapt (iostream);
+
+	dc_usecs_t begin = 0, end = 0;
+	if (iostream->timer)
+		dc_timer_now (iostream->timer, &begin);
+
 	status = iostream->vtable->read (iostream, data, size, &nbytes);
 
+	if (iostream->timer)
+		dc_timer_now (iostream->timer, &end);
+
+	if (status == DC_STATUS_TIMEOUT) {
+		// Discard the measurement of the exchange, because a late answer
+		// can't be matched with its request, and back off.
+		iostream->exchange = EXCHANGE_NONE;
+		if (iostream->backoff < RTO_MAXBACKOFF)
+			iostream->backoff++;
+	} else if (status == DC_STATUS_SUCCESS && iostream->exchange != EXCHANGE_NONE) {
+		iostream->exchange = EXCHANGE_ANSWER;
+		iostream->exchange_end = end;
+	}
+
+	if (iostream->statistics) {
+		dc_statistics_t *statistics = iostream->statistics;
+		statistics->read_time += (end - begin) / 1000000.0;
+		statistics->nreads++;
+		statistics->nbytes_read += nbytes;
+		if (status == DC_STATUS_TIMEOUT)
+			statistics->ntimeouts++;
+		// The first read after a write completes a round trip.
+		if (iostream->written) {
+			statistics->nroundtrips++;
+			iostream->written = 0;
+		}
+	}
+
+	dc_capture_record (iostream->capture, DC_CAPTURE_READ, status, data, nbytes);
+
 	HEXDUMP (iostream->context, DC_LOGLEVEL_INFO, "Read", (unsigned char *) data, nbytes);
 
 out:
@@ -181,8 +455,30 @@ dc_iostream_write (dc_iostream_t *iostream, const void *data, size_t size, size_
 		goto out;
 	}
 
+	// The answer of the previous exchange is complete as soon as the
+	// next request is sent.
+	if (iostream->timer) {
+		dc_usecs_t now = 0;
+		dc_timer_now (iostream->timer, &now);
+		if (iostream->exchange == EXCHANGE_ANSWER) {
+			dc_iostream_rtt_sample (iostream, (iostream->exchange_end - iostream->exchange_begin) / 1000.0);
+		}
+		if (iostream->exchange != EXCHANGE_REQUEST) {
+			iostream->exchange = EXCHANGE_REQUEST;
+			iostream->exchange_begin = now;
+		}
+	}
+
 	status = iostream->vtable->write (iostream, data, size, &nbytes);
 
+	if (iostream->statistics) {
+		iostream->statistics->nwrites++;
+		iostream->statistics->nbytes_written += nbytes;
+		iostream->written = 1;
+	}
+
+	dc_capture_record (iostream->capture, DC_CAPTURE_WRITE, status, data, nbytes);
+
 	HEXDUMP (iostream->context, DC_LOGLEVEL_INFO, "Write", (const unsigned char *) data, nbytes);
 
 out:
@@ -195,34 +491,68 @@ out:
 dc_status_t
 dc_iostream_flush (dc_iostream_t *iostream)
 {
-	if (iostream == NULL || iostream->vtable->flush == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	INFO (iostream->context, "Flush: none");
 
-	return iostream->vtable->flush (iostream);
+	if (iostream->vtable->flush == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->flush (iostream);
+	}
+
+	dc_capture_record (iostream->capture, DC_CAPTURE_FLUSH, status, NULL, 0);
+
+	return status;
 }
 
 dc_status_t
 dc_iostream_purge (dc_iostream_t *iostream, dc_direction_t direction)
 {
-	if (iostream == NULL || iostream->vtable->purge == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	INFO (iostream->context, "Purge: direction=%u", direction);
 
-	return iostream->vtable->purge (iostream, direction);
+	if (iostream->vtable->purge == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->purge (iostream, direction);
+	}
+
+	dc_iostream_capture (iostream, DC_CAPTURE_PURGE, status, direction);
+
+	return status;
 }
 
 dc_status_t
 dc_iostream_sleep (dc_iostream_t *iostream, unsigned int milliseconds)
 {
-	if (iostream == NULL || iostream->vtable->sleep == NULL)
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (iostream == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	INFO (iostream->context, "Sleep: value=%u", milliseconds);
 
-	return iostream->vtable->sleep (iostream, milliseconds);
+	if (iostream->statistics) {
+		iostream->statistics->sleep_time += milliseconds / 1000.0;
+	}
+
+	if (iostream->vtable->sleep == NULL) {
+		status = DC_STATUS_UNSUPPORTED;
+	} else {
+		status = iostream->vtable->sleep (iostream, milliseconds);
+	}
+
+	dc_iostream_capture (iostream, DC_CAPTURE_SLEEP, status, milliseconds);
+
+	return status;
 }
 
 dc_status_t
@@ -237,6 +567,8 @@ dc_iostream_close (dc_iostream_t *iostream)
 		status = iostream->vtable->close (iostream);
 	}
 
+	dc_capture_record (iostream->capture, DC_CAPTURE_CLOSE, status, NULL, 0);
+
 	dc_iostream_deallocate (iostream);
 
 	return status;
@@ -290,6 +290,11 @@ dc_irda_iterator_next (dc_iterator_t *abstract, void *out)
 dc_status_t
 dc_irda_open (dc_iostream_t **out, dc_context_t *context, unsigned int address, unsigned int lsap)
 {
+	// Are we replaying a capture file?
+	dc_capture_t *capture = _dc_context_capture (context);
+	if (dc_capture_isreplay (capture))
+		return dc_capture_open (out, context, capture);
+
 #ifdef IRDA
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_socket_t *device = NULL;
@@ -113,24 +113,33 @@ mares_common_packet (mares_common_device_t *device, const unsigned char command[
 		}
 	}
 
+	assert (asize <= PACKETSIZE);
+
 	// Receive the answer of the device.
-	status = dc_iostream_read (device->iostream, answer, asize, NULL);
+	unsigned char packet[2 * (PACKETSIZE + 2)] = {0};
+	unsigned int psize = 2 * (asize + 2);
+	status = dc_iostream_read (device->iostream, packet, psize, NULL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to receive the answer.");
 		return status;
 	}
 
 	// Verify the header and trailer of the packet.
-	if (answer[0] != '<' || answer[asize - 1] != '>') {
+	if (packet[0] != '<' || packet[psize - 1] != '>') {
 		ERROR (abstract->context, "Unexpected answer header/trailer byte.");
 		return DC_STATUS_PROTOCOL;
 	}
 
+	// Convert the data and calculate the checksum in a single pass.
+	unsigned char ccrc = 0x00;
+	if (array_convert_hex2bin_add (packet + 1, 2 * asize, answer, asize, &ccrc) != 0) {
+		ERROR (abstract->context, "Unexpected answer data.");
+		return DC_STATUS_PROTOCOL;
+	}
+
 	// Verify the checksum of the packet.
 	unsigned char crc = 0;
-	unsigned char ccrc = checksum_add_uint8 (answer + 1, asize - 4, 0x00);
-	array_convert_hex2bin (answer + asize - 3, 2, &crc, 1);
-	if (crc != ccrc) {
+	if (array_convert_hex2bin (packet + psize - 3, 2, &crc, 1) != 0 || crc != ccrc) {
 		ERROR (abstract->context, "Unexpected answer checksum.");
 		return DC_STATUS_PROTOCOL;
 	}
@@ -154,6 +163,8 @@ mares_common_transfer (mares_common_device_t *device, const unsigned char comman
 		if (nretries++ >= MAXRETRIES)
 			return rc;
 
+		device_statistics_retry ((dc_device_t *) device);
+
 		// Discard any garbage bytes.
 		dc_iostream_sleep (device->iostream, 100);
 		dc_iostream_purge (device->iostream, DC_DIRECTION_INPUT);
@@ -186,14 +197,10 @@ mares_common_device_read (dc_device_t *abstract, unsigned int address, unsigned
 		mares_common_make_ascii (raw, sizeof (raw), command, sizeof (command));
 
 		// Send the command and receive the answer.
-		unsigned char answer[2 * (PACKETSIZE + 2)] = {0};
-		dc_status_t rc = mares_common_transfer (device, command, sizeof (command), answer, 2 * (len + 2));
+		dc_status_t rc = mares_common_transfer (device, command, sizeof (command), data, len);
 		if (rc != DC_STATUS_SUCCESS)
 			return rc;
 
-		// Extract the raw data from the packet.
-		array_convert_hex2bin (answer + 1, 2 * len, data, len);
-
 		nbytes += len;
 		address += len;
 		data += len;
@@ -28,8 +28,10 @@
 #include "mares_darwin.h"
 #include "mares_common.h"
 #include "context-private.h"
+#include "iostream-private.h"
 #include "device-private.h"
 #include "array.h"
+#include "rbstream.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &mares_darwin_device_vtable)
 
@@ -94,9 +96,6 @@ static const mares_darwin_layout_t mares_darwinair_layout = {
 	3       /* samplesize */
 };
 
-static dc_status_t
-mares_darwin_extract_dives (dc_device_t *device, const unsigned char data[], unsigned int size, dc_dive_callback_t callback, void *userdata);
-
 dc_status_t
 mares_darwin_device_open (dc_device_t **out, dc_context_t *context, const char *name, unsigned int model)
 {
@@ -131,6 +130,9 @@ mares_darwin_device_open (dc_device_t **out, dc_context_t *context, const char *
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->base.iostream);
+
 	// Set the serial communication protocol (9600 8N1).
 	status = dc_iostream_configure (device->base.iostream, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -145,6 +147,9 @@ mares_darwin_device_open (dc_device_t **out, dc_context_t *context, const char *
 		goto error_close;
 	}
 
+	// Enable the adaptive timeout.
+	dc_iostream_set_adaptive (device->base.iostream, 1);
+
 	// Set the DTR line.
 	status = dc_iostream_set_dtr (device->base.iostream, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -237,113 +242,129 @@ mares_darwin_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback,
 
 	assert (device->layout != NULL);
 
-	dc_buffer_t *buffer = dc_buffer_new (device->layout->memsize);
-	if (buffer == NULL)
+	const mares_darwin_layout_t *layout = device->layout;
+
+	// Enable progress notifications.
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	progress.maximum = layout->memsize;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	// Read the header and logbook data.
+	unsigned char *header = (unsigned char *) malloc (layout->rb_profile_begin);
+	if (header == NULL) {
+		ERROR (abstract->context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
+	}
 
-	dc_status_t rc = mares_darwin_device_dump (abstract, buffer);
+	dc_status_t rc = mares_common_device_read (abstract, 0, header, layout->rb_profile_begin);
 	if (rc != DC_STATUS_SUCCESS) {
-		dc_buffer_free (buffer);
+		ERROR (abstract->context, "Failed to read the logbook data.");
+		free (header);
 		return rc;
 	}
 
 	// Emit a device info event.
-	unsigned char *data = dc_buffer_get_data (buffer);
 	dc_event_devinfo_t devinfo;
 	devinfo.model = device->model;
 	devinfo.firmware = 0;
-	devinfo.serial = array_uint16_be (data + 8);
+	devinfo.serial = array_uint16_be (header + 8);
 	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
 
-	rc = mares_darwin_extract_dives (abstract, dc_buffer_get_data (buffer),
-		dc_buffer_get_size (buffer), callback, userdata);
-
-	dc_buffer_free (buffer);
-
-	return rc;
-}
-
-
-static dc_status_t
-mares_darwin_extract_dives (dc_device_t *abstract, const unsigned char data[], unsigned int size, dc_dive_callback_t callback, void *userdata)
-{
-	mares_darwin_device_t *device = (mares_darwin_device_t *) abstract;
-
-	if (!ISINSTANCE (abstract))
-		return DC_STATUS_INVALIDARGS;
-
-	assert (device->layout != NULL);
-
-	const mares_darwin_layout_t *layout = device->layout;
-
 	// Get the profile pointer.
-	unsigned int eop = array_uint16_be (data + 0x8A);
+	unsigned int eop = array_uint16_be (header + 0x8A);
 	if (eop < layout->rb_profile_begin || eop >= layout->rb_profile_end) {
 		ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%04x).", eop);
+		free (header);
 		return DC_STATUS_DATAFORMAT;
 	}
 
 	// Get the logbook index.
-	unsigned int last = data[0x8C];
+	unsigned int last = header[0x8C];
 	if (last >= layout->rb_logbook_count) {
 		ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%02x).", last);
+		free (header);
 		return DC_STATUS_DATAFORMAT;
 	}
 
-	// Allocate memory for the largest possible dive.
-	unsigned char *buffer = (unsigned char *) malloc (layout->rb_logbook_size + layout->rb_profile_end - layout->rb_profile_begin);
-	if (buffer == NULL) {
-		ERROR (abstract->context, "Failed to allocate memory.");
-		return DC_STATUS_NOMEMORY;
-	}
-
 	// The logbook ringbuffer can store a fixed amount of entries, but there
 	// is no guarantee that the profile ringbuffer will contain a profile for
-	// each entry. The number of remaining bytes (which is initialized to the
-	// largest possible value) is used to detect the last valid profile.
-	unsigned int remaining = layout->rb_profile_end - layout->rb_profile_begin;
-
-	unsigned int current = eop;
+	// each entry. The total length of all profiles is used to detect the
+	// last valid profile. Because the fingerprint is stored in the logbook
+	// entry, the number of new dives is also known before any profile data
+	// is downloaded.
+	unsigned int count = 0;
+	unsigned int total = 0;
 	for (unsigned int i = 0; i < layout->rb_logbook_count; ++i) {
 		// Get the offset to the current logbook entry in the ringbuffer.
 		unsigned int idx = (layout->rb_logbook_count + last - i) % layout->rb_logbook_count;
 		unsigned int offset = layout->rb_logbook_offset + idx * layout->rb_logbook_size;
 
 		// Get the length of the current dive.
-		unsigned int nsamples = array_uint16_be (data + offset + 6);
+		unsigned int nsamples = array_uint16_be (header + offset + 6);
 		unsigned int length = nsamples * layout->samplesize;
-		if (nsamples == 0xFFFF || length > remaining)
+		if (nsamples == 0xFFFF || total + length > layout->rb_profile_end - layout->rb_profile_begin)
 			break;
 
-		// Copy the logbook entry.
-		memcpy (buffer, data + offset, layout->rb_logbook_size);
-
-		// Copy the profile data.
-		if (current < layout->rb_profile_begin + length) {
-			unsigned int a = current - layout->rb_profile_begin;
-			unsigned int b = length - a;
-			memcpy (buffer + layout->rb_logbook_size, data + layout->rb_profile_end - b, b);
-			memcpy (buffer + layout->rb_logbook_size + b, data + layout->rb_profile_begin, a);
-			current = layout->rb_profile_end - b;
-		} else {
-			memcpy (buffer + layout->rb_logbook_size, data + current - length, length);
-			current -= length;
-		}
+		// Check the fingerprint data.
+		if (memcmp (header + offset, device->fingerprint, sizeof (device->fingerprint)) == 0)
+			break;
 
-		if (memcmp (buffer, device->fingerprint, sizeof (device->fingerprint)) == 0) {
-			free (buffer);
-			return DC_STATUS_SUCCESS;
-		}
+		total += length;
+		count++;
+	}
+
+	// Update and emit a progress event.
+	progress.current += layout->rb_profile_begin;
+	progress.maximum = layout->rb_profile_begin + total;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
-		if (callback && !callback (buffer, layout->rb_logbook_size + length, buffer, 6, userdata)) {
-			free (buffer);
-			return DC_STATUS_SUCCESS;
+	// Create the ringbuffer stream.
+	dc_rbstream_t *rbstream = NULL;
+	rc = dc_rbstream_new (&rbstream, abstract, 1, PACKETSIZE, layout->rb_profile_begin, layout->rb_profile_end, eop);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to create the ringbuffer stream.");
+		free (header);
+		return rc;
+	}
+
+	// Allocate memory for the largest possible new dive.
+	unsigned char *buffer = (unsigned char *) malloc (layout->rb_logbook_size + total);
+	if (buffer == NULL) {
+		ERROR (abstract->context, "Failed to allocate memory.");
+		dc_rbstream_free (rbstream);
+		free (header);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// The profile data is read backwards, starting from the most recent
+	// dive, and each dive is passed to the application as soon as it has
+	// been downloaded. The download stops at the first dive that is
+	// already known, or when the application cancels the enumeration.
+	for (unsigned int i = 0; i < count; ++i) {
+		unsigned int idx = (layout->rb_logbook_count + last - i) % layout->rb_logbook_count;
+		unsigned int offset = layout->rb_logbook_offset + idx * layout->rb_logbook_size;
+
+		// Get the length of the current dive.
+		unsigned int nsamples = array_uint16_be (header + offset + 6);
+		unsigned int length = nsamples * layout->samplesize;
+
+		// Copy the logbook entry.
+		memcpy (buffer, header + offset, layout->rb_logbook_size);
+
+		// Read the profile data.
+		rc = dc_rbstream_read (rbstream, &progress, buffer + layout->rb_logbook_size, length);
+		if (rc != DC_STATUS_SUCCESS) {
+			ERROR (abstract->context, "Failed to read the dive.");
+			break;
 		}
 
-		remaining -= length;
+		if (callback && !callback (buffer, layout->rb_logbook_size + length, buffer, 6, userdata))
+			break;
 	}
 
+	dc_rbstream_free (rbstream);
 	free (buffer);
+	free (header);
 
-	return DC_STATUS_SUCCESS;
+	return rc;
 }
@@ -26,6 +26,7 @@
 #include "mares_puck.h"
 #include "mares_common.h"
 #include "context-private.h"
+#include "iostream-private.h"
 #include "device-private.h"
 #include "serial.h"
 #include "checksum.h"
@@ -116,6 +117,9 @@ mares_puck_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->base.iostream);
+
 	// Set the serial communication protocol (38400 8N1).
 	status = dc_iostream_configure (device->base.iostream, 38400, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -130,6 +134,9 @@ mares_puck_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_close;
 	}
 
+	// Enable the adaptive timeout.
+	dc_iostream_set_adaptive (device->base.iostream, 1);
+
 	// Clear the DTR line.
 	status = dc_iostream_set_dtr (device->base.iostream, 0);
 	if (status != DC_STATUS_SUCCESS) {
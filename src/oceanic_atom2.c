@@ -547,6 +547,8 @@ oceanic_atom2_transfer (oceanic_atom2_device_t *device, const unsigned char comm
 		if (nretries++ >= MAXRETRIES)
 			return rc;
 
+		device_statistics_retry ((dc_device_t *) device);
+
 		// Increase the inter packet delay.
 		if (device->delay < MAXDELAY)
 			device->delay++;
@@ -606,6 +608,9 @@ oceanic_atom2_device_open (dc_device_t **out, dc_context_t *context, const char
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->iostream);
+
 	// Get the correct baudrate.
 	unsigned int baudrate = 38400;
 	if (model == VTX || model == I750TC) {
@@ -32,6 +32,8 @@
 
 #define VTABLE(abstract)	((const oceanic_common_device_vtable_t *) abstract->vtable)
 
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
 #define RB_LOGBOOK_DISTANCE(a,b,l)	ringbuffer_distance (a, b, 1, l->rb_logbook_begin, l->rb_logbook_end)
 #define RB_LOGBOOK_INCR(a,b,l)		ringbuffer_increment (a, b, l->rb_logbook_begin, l->rb_logbook_end)
 
@@ -40,51 +42,73 @@
 
 #define INVALID 0
 
-static unsigned int
-get_profile_first (const unsigned char data[], const oceanic_common_layout_t *layout)
+typedef struct oceanic_common_pointer_t {
+	// Offsets of the first and last profile pointers in a logbook entry.
+	unsigned int first;
+	unsigned int last;
+	// Shift, mask and scale factor to convert the stored values to
+	// memory addresses.
+	unsigned int shift;
+	unsigned int mask;
+	unsigned int scale;
+	// Profile ringbuffer.
+	unsigned int begin;
+	unsigned int size;
+} oceanic_common_pointer_t;
+
+/*
+ * Resolve the logbook pointer mode of the layout into a plain description
+ * of the profile pointers, such that each logbook entry can be decoded
+ * without any further branching on the layout.
+ */
+static void
+oceanic_common_pointer_init (oceanic_common_pointer_t *pointer, const oceanic_common_layout_t *layout)
 {
-	unsigned int value;
-
-	if (layout->pt_mode_logbook == 0) {
-		value = array_uint16_le (data + 5);
-	} else if (layout->pt_mode_logbook == 1) {
-		value = array_uint16_le (data + 4);
-	} else if (layout->pt_mode_logbook == 3) {
-		value = array_uint16_le (data + 16);
+	// Offsets and shift for each pointer mode.
+	static const unsigned int modes[][3] = {
+		{5,  6,  4}, // Two 12-bit page numbers.
+		{4,  6,  0}, // Two 16-bit page numbers.
+		{16, 18, 0}, // Two 16-bit addresses.
+		{16, 18, 0}, // Two 16-bit page numbers.
+	};
+
+	unsigned int mode = layout->pt_mode_logbook;
+	if (mode >= C_ARRAY_SIZE (modes))
+		mode = 2;
+
+	pointer->first = modes[mode][0];
+	pointer->last  = modes[mode][1];
+	pointer->shift = modes[mode][2];
+
+	if (mode == 2) {
+		pointer->mask = 0xFFFF;
+		pointer->scale = 1;
 	} else {
-		return array_uint16_le (data + 16);
+		if (layout->memsize > 0x20000)
+			pointer->mask = 0x3FFF;
+		else if (layout->memsize > 0x10000)
+			pointer->mask = 0x1FFF;
+		else
+			pointer->mask = 0x0FFF;
+		pointer->scale = PAGESIZE;
 	}
 
-	if (layout->memsize > 0x20000)
-		return (value & 0x3FFF) * PAGESIZE;
-	else if (layout->memsize > 0x10000)
-		return (value & 0x1FFF) * PAGESIZE;
-	else
-		return (value & 0x0FFF) * PAGESIZE;
+	pointer->begin = layout->rb_profile_begin;
+	pointer->size = layout->rb_profile_end - layout->rb_profile_begin;
 }
 
-
-static unsigned int
-get_profile_last (const unsigned char data[], const oceanic_common_layout_t *layout)
+/*
+ * Get the profile pointers of a logbook entry. Returns non-zero if both
+ * pointers are inside the profile ringbuffer.
+ */
+static int
+oceanic_common_pointer_get (const unsigned char data[], const oceanic_common_pointer_t *pointer, unsigned int *first, unsigned int *last)
 {
-	unsigned int value;
-
-	if (layout->pt_mode_logbook == 0) {
-		value = array_uint16_le (data + 6) >> 4;
-	} else if (layout->pt_mode_logbook == 1) {
-		value = array_uint16_le (data + 6);
-	} else if (layout->pt_mode_logbook == 3) {
-		value = array_uint16_le (data + 18);
-	} else {
-		return array_uint16_le(data + 18);
-	}
+	*first = (array_uint16_le (data + pointer->first) & pointer->mask) * pointer->scale;
+	*last = ((array_uint16_le (data + pointer->last) >> pointer->shift) & pointer->mask) * pointer->scale;
 
-	if (layout->memsize > 0x20000)
-		return (value & 0x3FFF) * PAGESIZE;
-	else if (layout->memsize > 0x10000)
-		return (value & 0x1FFF) * PAGESIZE;
-	else
-		return (value & 0x0FFF) * PAGESIZE;
+	return *first - pointer->begin < pointer->size &&
+		*last - pointer->begin < pointer->size;
 }
 
 
@@ -148,6 +172,189 @@ oceanic_common_device_set_fingerprint (dc_device_t *abstract, const unsigned cha
 }
 
 
+static void
+oceanic_common_device_devinfo (dc_device_t *abstract, const unsigned char id[])
+{
+	oceanic_common_device_t *device = (oceanic_common_device_t *) abstract;
+	const oceanic_common_layout_t *layout = device->layout;
+
+	// Emit a device info event.
+	dc_event_devinfo_t devinfo;
+	devinfo.model = array_uint16_be (id + 8);
+	devinfo.firmware = 0;
+	if (layout->pt_mode_serial == 0)
+		devinfo.serial = bcd2dec (id[10]) * 10000 + bcd2dec (id[11]) * 100 + bcd2dec (id[12]);
+	else if (layout->pt_mode_serial == 1)
+		devinfo.serial = id[11] * 10000 + id[12] * 100 + id[13];
+	else
+		devinfo.serial =
+			(id[11] & 0x0F) * 100000 + ((id[11] & 0xF0) >> 4) * 10000 +
+			(id[12] & 0x0F) * 1000   + ((id[12] & 0xF0) >> 4) * 100 +
+			(id[13] & 0x0F) * 10     + ((id[13] & 0xF0) >> 4) * 1;
+	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+}
+
+
+static unsigned int
+oceanic_common_logbook_end (unsigned int last, const oceanic_common_layout_t *layout)
+{
+	if (layout->pt_mode_global == 0) {
+		return RB_LOGBOOK_INCR (last, layout->rb_logbook_entry_size, layout);
+	} else {
+		return last;
+	}
+}
+
+
+static dc_status_t
+oceanic_common_device_dump_delta (dc_device_t *abstract, unsigned char data[], unsigned int size, const unsigned char cache[])
+{
+	oceanic_common_device_t *device = (oceanic_common_device_t *) abstract;
+	const oceanic_common_layout_t *layout = device->layout;
+	unsigned int blocksize = PAGESIZE * device->multipage;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	// Get the profile pointer format.
+	oceanic_common_pointer_t pointer;
+	oceanic_common_pointer_init (&pointer, layout);
+
+	// Enable progress notifications.
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	progress.maximum = size;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	// Start from the cached memory image.
+	memcpy (data, cache, size);
+
+	// Re-read everything outside the two ringbuffers. This area contains
+	// the settings and the ringbuffer pointers, and is always small.
+	unsigned int rb1_begin = layout->rb_logbook_begin, rb1_end = layout->rb_logbook_end;
+	unsigned int rb2_begin = layout->rb_profile_begin, rb2_end = layout->rb_profile_end;
+	if (rb2_begin < rb1_begin) {
+		rb1_begin = layout->rb_profile_begin;
+		rb1_end = layout->rb_profile_end;
+		rb2_begin = layout->rb_logbook_begin;
+		rb2_end = layout->rb_logbook_end;
+	}
+
+	const unsigned int ranges[][2] = {
+		{0, rb1_begin},
+		{rb1_end, rb2_begin},
+		{rb2_end, size}};
+	for (unsigned int i = 0; i < C_ARRAY_SIZE(ranges); ++i) {
+		if (ranges[i][0] >= ranges[i][1])
+			continue;
+		rc = device_dump_read_range (abstract, &progress, data, size, ranges[i][0], ranges[i][1], PAGESIZE, blocksize);
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+	}
+
+	// Get the logbook pointers.
+	const unsigned char *pointers = data + layout->cf_pointers;
+	const unsigned char *oldpointers = cache + layout->cf_pointers;
+	unsigned int rb_logbook_first = array_uint16_le (pointers + 4);
+	unsigned int rb_logbook_last  = array_uint16_le (pointers + 6);
+	unsigned int rb_logbook_oldlast = array_uint16_le (oldpointers + 6);
+	if (rb_logbook_first < layout->rb_logbook_begin ||
+		rb_logbook_first >= layout->rb_logbook_end ||
+		rb_logbook_last < layout->rb_logbook_begin ||
+		rb_logbook_last >= layout->rb_logbook_end ||
+		rb_logbook_oldlast < layout->rb_logbook_begin ||
+		rb_logbook_oldlast >= layout->rb_logbook_end)
+	{
+		WARNING (abstract->context, "Invalid logbook pointers detected. Downloading both ringbuffers.");
+		goto full;
+	}
+
+	// The cached logbook entries and profiles can only be kept if less
+	// than one full lap of the logbook ringbuffer was written since the
+	// cache was made. In that case, the most recent cached logbook entry
+	// is still present unchanged on the device.
+	unsigned int rb_logbook_oldnext = RB_LOGBOOK_INCR (rb_logbook_oldlast, layout->rb_logbook_entry_size, layout);
+	rc = device_dump_read_ringbuffer (abstract, &progress, data, size,
+		layout->rb_logbook_begin, layout->rb_logbook_end,
+		rb_logbook_oldlast, rb_logbook_oldnext, PAGESIZE, blocksize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	if (memcmp (data + rb_logbook_oldlast, cache + rb_logbook_oldlast, layout->rb_logbook_entry_size) != 0) {
+		WARNING (abstract->context, "Cached logbook entries overwritten. Downloading both ringbuffers.");
+		goto full;
+	}
+
+	// Nothing else changed if the ringbuffer pointers are unchanged.
+	if (memcmp (pointers, oldpointers, PAGESIZE) == 0)
+		goto done;
+
+	unsigned int rb_logbook_end = oceanic_common_logbook_end (rb_logbook_last, layout);
+	unsigned int rb_logbook_oldend = oceanic_common_logbook_end (rb_logbook_oldlast, layout);
+
+	// Only the logbook entries between the old and the new end pointer
+	// can have changed. If the old end pointer is no longer inside the
+	// valid part of the ringbuffer, all entries are new.
+	unsigned int start = rb_logbook_oldend;
+	if (ringbuffer_distance (rb_logbook_first, rb_logbook_oldend, 0, layout->rb_logbook_begin, layout->rb_logbook_end) >
+		ringbuffer_distance (rb_logbook_first, rb_logbook_end, 0, layout->rb_logbook_begin, layout->rb_logbook_end))
+		start = rb_logbook_first;
+
+	rc = device_dump_read_ringbuffer (abstract, &progress, data, size,
+		layout->rb_logbook_begin, layout->rb_logbook_end,
+		start, rb_logbook_end, PAGESIZE, blocksize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// Download the profile data of the new logbook entries.
+	unsigned int entry = start;
+	while (entry != rb_logbook_end) {
+		const unsigned char *p = data + entry;
+		entry = RB_LOGBOOK_INCR (entry, layout->rb_logbook_entry_size, layout);
+
+		if (array_isequal (p, layout->rb_logbook_entry_size, 0xFF))
+			continue;
+
+		unsigned int rb_entry_first = 0, rb_entry_last = 0;
+		if (!oceanic_common_pointer_get (p, &pointer, &rb_entry_first, &rb_entry_last)) {
+			ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%06x 0x%06x).",
+				rb_entry_first, rb_entry_last);
+			return DC_STATUS_DATAFORMAT;
+		}
+
+		unsigned int rb_entry_end = RB_PROFILE_INCR (rb_entry_last, PAGESIZE, layout);
+		if (rb_entry_first == rb_entry_end) {
+			// The profile fills the entire ringbuffer.
+			rc = device_dump_read_range (abstract, &progress, data, size,
+				layout->rb_profile_begin, layout->rb_profile_end, PAGESIZE, blocksize);
+		} else {
+			rc = device_dump_read_ringbuffer (abstract, &progress, data, size,
+				layout->rb_profile_begin, layout->rb_profile_end,
+				rb_entry_first, rb_entry_end, PAGESIZE, blocksize);
+		}
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+	}
+
+	goto done;
+
+full:
+	progress.maximum = progress.current +
+		(layout->rb_logbook_end - layout->rb_logbook_begin) +
+		(layout->rb_profile_end - layout->rb_profile_begin);
+	rc = device_dump_read_range (abstract, &progress, data, size, layout->rb_logbook_begin, layout->rb_logbook_end, PAGESIZE, blocksize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+	rc = device_dump_read_range (abstract, &progress, data, size, layout->rb_profile_begin, layout->rb_profile_end, PAGESIZE, blocksize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+done:
+	// Update and emit a progress event.
+	progress.maximum = progress.current;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 dc_status_t
 oceanic_common_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 {
@@ -156,20 +363,45 @@ oceanic_common_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	assert (device != NULL);
 	assert (device->layout != NULL);
 
+	const oceanic_common_layout_t *layout = device->layout;
+
 	// Allocate the required amount of memory.
-	if (!dc_buffer_resize (buffer, device->layout->memsize)) {
+	if (!dc_buffer_resize (buffer, layout->memsize)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_NOMEMORY;
 	}
 
+	unsigned char *data = dc_buffer_get_data (buffer);
+	unsigned int size = dc_buffer_get_size (buffer);
+
 	// Emit a vendor event.
 	dc_event_vendor_t vendor;
 	vendor.data = device->version;
 	vendor.size = sizeof (device->version);
 	device_event_emit (abstract, DC_EVENT_VENDOR, &vendor);
 
-	return device_dump_read (abstract, dc_buffer_get_data (buffer),
-		dc_buffer_get_size (buffer), PAGESIZE * device->multipage);
+	// Read the device id.
+	dc_status_t rc = dc_device_read (abstract, layout->cf_devinfo, data + layout->cf_devinfo, PAGESIZE);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to read the memory page.");
+		return rc;
+	}
+
+	// Emit a device info event. This gives the application the
+	// opportunity to register the memory cache for this device.
+	oceanic_common_device_devinfo (abstract, data + layout->cf_devinfo);
+
+	// The memory cache can only be used if it belongs to the same device,
+	// and if the ringbuffer pointers are in the standard format.
+	const unsigned char *cache = device_cache_get (abstract, size);
+	if (cache == NULL ||
+		VTABLE(abstract)->logbook != oceanic_common_device_logbook ||
+		layout->rb_logbook_begin == layout->rb_logbook_end ||
+		memcmp (cache + layout->cf_devinfo, data + layout->cf_devinfo, PAGESIZE) != 0) {
+		return device_dump_read (abstract, data, size, PAGESIZE * device->multipage);
+	}
+
+	return oceanic_common_device_dump_delta (abstract, data, size, cache);
 }
 
 
@@ -216,12 +448,7 @@ oceanic_common_device_logbook (dc_device_t *abstract, dc_event_progress_t *progr
 	}
 
 	// Calculate the end pointer.
-	unsigned int rb_logbook_end = 0;
-	if (layout->pt_mode_global == 0) {
-		rb_logbook_end  = RB_LOGBOOK_INCR (rb_logbook_last, layout->rb_logbook_entry_size, layout);
-	} else {
-		rb_logbook_end  = rb_logbook_last;
-	}
+	unsigned int rb_logbook_end = oceanic_common_logbook_end (rb_logbook_last, layout);
 
 	// Calculate the number of bytes.
 	// In a typical ringbuffer implementation with only two begin/end
@@ -330,6 +557,10 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 
 	const oceanic_common_layout_t *layout = device->layout;
 
+	// Get the profile pointer format.
+	oceanic_common_pointer_t pointer;
+	oceanic_common_pointer_init (&pointer, layout);
+
 	// Cache the logbook pointer and size.
 	const unsigned char *logbooks = dc_buffer_get_data (logbook);
 	unsigned int rb_logbook_size = dc_buffer_get_size (logbook);
@@ -352,13 +583,8 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 		entry -= layout->rb_logbook_entry_size;
 
 		// Get the profile pointers.
-		unsigned int rb_entry_first = get_profile_first (logbooks + entry, layout);
-		unsigned int rb_entry_last  = get_profile_last (logbooks + entry, layout);
-		if (rb_entry_first < layout->rb_profile_begin ||
-			rb_entry_first >= layout->rb_profile_end ||
-			rb_entry_last < layout->rb_profile_begin ||
-			rb_entry_last >= layout->rb_profile_end)
-		{
+		unsigned int rb_entry_first = 0, rb_entry_last = 0;
+		if (!oceanic_common_pointer_get (logbooks + entry, &pointer, &rb_entry_first, &rb_entry_last)) {
 			ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%06x 0x%06x).",
 				rb_entry_first, rb_entry_last);
 			break;
@@ -430,13 +656,8 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 		entry -= layout->rb_logbook_entry_size;
 
 		// Get the profile pointers.
-		unsigned int rb_entry_first = get_profile_first (logbooks + entry, layout);
-		unsigned int rb_entry_last  = get_profile_last (logbooks + entry, layout);
-		if (rb_entry_first < layout->rb_profile_begin ||
-			rb_entry_first >= layout->rb_profile_end ||
-			rb_entry_last < layout->rb_profile_begin ||
-			rb_entry_last >= layout->rb_profile_end)
-		{
+		unsigned int rb_entry_first = 0, rb_entry_last = 0;
+		if (!oceanic_common_pointer_get (logbooks + entry, &pointer, &rb_entry_first, &rb_entry_last)) {
 			ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%06x 0x%06x).",
 				rb_entry_first, rb_entry_last);
 			dc_rbstream_free (rbstream);
@@ -530,19 +751,7 @@ oceanic_common_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
 	// Emit a device info event.
-	dc_event_devinfo_t devinfo;
-	devinfo.model = array_uint16_be (id + 8);
-	devinfo.firmware = 0;
-	if (layout->pt_mode_serial == 0)
-		devinfo.serial = bcd2dec (id[10]) * 10000 + bcd2dec (id[11]) * 100 + bcd2dec (id[12]);
-	else if (layout->pt_mode_serial == 1)
-		devinfo.serial = id[11] * 10000 + id[12] * 100 + id[13];
-	else
-		devinfo.serial =
-			(id[11] & 0x0F) * 100000 + ((id[11] & 0xF0) >> 4) * 10000 +
-			(id[12] & 0x0F) * 1000   + ((id[12] & 0xF0) >> 4) * 100 +
-			(id[13] & 0x0F) * 10     + ((id[13] & 0xF0) >> 4) * 1;
-	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+	oceanic_common_device_devinfo (abstract, id);
 
 	// Memory buffer for the logbook data.
 	dc_buffer_t *logbook = dc_buffer_new (0);
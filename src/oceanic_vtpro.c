@@ -185,6 +185,8 @@ oceanic_vtpro_transfer (oceanic_vtpro_device_t *device, const unsigned char comm
 		// Abort if the maximum number of retries is reached.
 		if (nretries++ >= MAXRETRIES)
 			return rc;
+
+		device_statistics_retry ((dc_device_t *) device);
 	}
 
 	if (asize) {
@@ -426,6 +428,9 @@ oceanic_vtpro_device_open (dc_device_t **out, dc_context_t *context, const char
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->iostream);
+
 	// Set the serial communication protocol (9600 8N1).
 	status = dc_iostream_configure (device->iostream, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -33,12 +33,45 @@ struct dc_parser_t;
 struct dc_parser_vtable_t;
 
 typedef struct dc_parser_vtable_t dc_parser_vtable_t;
+typedef struct dc_parser_chunk_t dc_parser_chunk_t;
+
+/*
+ * Seek index entry. The checkpoint is taken right before a sample is
+ * decoded, with the time of the previous sample, the offset of the
+ * sample and the backend specific decoder state at that point.
+ */
+typedef struct dc_parser_checkpoint_t {
+	unsigned int time;
+	unsigned int offset;
+	unsigned int state[4];
+} dc_parser_checkpoint_t;
 
 struct dc_parser_t {
 	const dc_parser_vtable_t *vtable;
 	dc_context_t *context;
 	const unsigned char *data;
 	unsigned int size;
+	dc_parser_chunk_t *arena;
+	// Sample types requested by the application.
+	unsigned int samplemask;
+	// Sample types to decode in the current samples_foreach call. Only
+	// restricted while the application's callback is running, because
+	// the parsers also iterate over the samples internally.
+	unsigned int activemask;
+	// Bucket size for the decimated samples (seconds), or zero.
+	unsigned int interval;
+	// Seek index, with a checkpoint every few seconds. Only used once
+	// it is complete, after the first full pass over the samples.
+	dc_parser_checkpoint_t *checkpoints;
+	unsigned int ncheckpoints;
+	unsigned int capacity;
+	unsigned int spacing;
+	unsigned int indexed;
+	// Time window of the current samples_foreach call. Only restricted
+	// while the application's callback is running, and only once the
+	// seek index is complete.
+	unsigned int begin;
+	unsigned int end;
 };
 
 struct dc_parser_vtable_t {
@@ -66,6 +99,33 @@ dc_parser_deallocate (dc_parser_t *parser);
 int
 dc_parser_isinstance (dc_parser_t *parser, const dc_parser_vtable_t *vtable);
 
+/*
+ * Per dive scratch memory. The memory is owned by the parser, remains
+ * valid until the next dc_parser_set_data() call, and must not be freed.
+ */
+void *
+dc_parser_alloc (dc_parser_t *parser, size_t size);
+
+char *
+dc_parser_strndup (dc_parser_t *parser, const char *str, size_t size);
+
+char *
+dc_parser_strdup (dc_parser_t *parser, const char *str);
+
+/*
+ * Add a checkpoint to the seek index, if it's being built and the
+ * previous checkpoint is far enough in the past.
+ */
+void
+dc_parser_checkpoint_add (dc_parser_t *parser, unsigned int time, unsigned int offset, const unsigned int state[], unsigned int nstate);
+
+/*
+ * Find the checkpoint to resume from, for the start of the current time
+ * window. Returns NULL if the decoding has to start from the beginning.
+ */
+const dc_parser_checkpoint_t *
+dc_parser_checkpoint_find (dc_parser_t *parser);
+
 typedef struct sample_statistics_t {
 	unsigned int divetime;
 	double maxdepth;
@@ -20,6 +20,8 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <assert.h>
 
 #include "suunto_d9.h"
@@ -61,8 +63,21 @@
 #include "parser-private.h"
 #include "device-private.h"
 
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
 #define REACTPROWHITE 0x4354
 
+#define ARENA_CHUNKSIZE 4096
+#define ARENA_ALIGNMENT 16
+
+struct dc_parser_chunk_t {
+	dc_parser_chunk_t *next;
+	size_t capacity;
+	size_t used;
+};
+
+#define ARENA_HEADERSIZE ((sizeof (dc_parser_chunk_t) + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1))
+
 static dc_status_t
 dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, dc_family_t family, unsigned int model, unsigned int serial, unsigned int devtime, dc_ticks_t systime)
 {
@@ -219,16 +234,113 @@ dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable)
 	parser->context = context;
 	parser->data = NULL;
 	parser->size = 0;
+	parser->arena = NULL;
+	parser->samplemask = DC_SAMPLE_MASK_ALL;
+	parser->activemask = DC_SAMPLE_MASK_ALL;
+	parser->interval = 0;
+	parser->checkpoints = NULL;
+	parser->ncheckpoints = 0;
+	parser->capacity = 0;
+	parser->spacing = 0;
+	parser->indexed = 0;
+	parser->begin = 0;
+	parser->end = UINT_MAX;
 
 	return parser;
 }
 
+static void
+dc_parser_arena_reset (dc_parser_t *parser)
+{
+	dc_parser_chunk_t *chunk = parser->arena;
+	if (chunk == NULL)
+		return;
+
+	// Keep only the most recent (and largest) chunk around for reuse.
+	dc_parser_chunk_t *next = chunk->next;
+	while (next) {
+		dc_parser_chunk_t *tmp = next->next;
+		free (next);
+		next = tmp;
+	}
+
+	chunk->next = NULL;
+	chunk->used = 0;
+}
+
 void
 dc_parser_deallocate (dc_parser_t *parser)
 {
+	if (parser == NULL)
+		return;
+
+	dc_parser_arena_reset (parser);
+	free (parser->arena);
+
+	free (parser->checkpoints);
+
 	free (parser);
 }
 
+void *
+dc_parser_alloc (dc_parser_t *parser, size_t size)
+{
+	if (parser == NULL)
+		return NULL;
+
+	size = (size + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1);
+
+	dc_parser_chunk_t *chunk = parser->arena;
+	if (chunk == NULL || size > chunk->capacity - chunk->used) {
+		// Grow geometrically, to keep the number of chunks small.
+		size_t capacity = chunk ? chunk->capacity * 2 : ARENA_CHUNKSIZE;
+		while (capacity < size)
+			capacity *= 2;
+
+		dc_parser_chunk_t *tmp = (dc_parser_chunk_t *) malloc (ARENA_HEADERSIZE + capacity);
+		if (tmp == NULL) {
+			ERROR (parser->context, "Failed to allocate memory.");
+			return NULL;
+		}
+
+		tmp->next = chunk;
+		tmp->capacity = capacity;
+		tmp->used = 0;
+
+		parser->arena = chunk = tmp;
+	}
+
+	void *ptr = (unsigned char *) chunk + ARENA_HEADERSIZE + chunk->used;
+	chunk->used += size;
+
+	return ptr;
+}
+
+char *
+dc_parser_strndup (dc_parser_t *parser, const char *str, size_t size)
+{
+	if (str == NULL)
+		return NULL;
+
+	char *ptr = (char *) dc_parser_alloc (parser, size + 1);
+	if (ptr == NULL)
+		return NULL;
+
+	memcpy (ptr, str, size);
+	ptr[size] = 0;
+
+	return ptr;
+}
+
+char *
+dc_parser_strdup (dc_parser_t *parser, const char *str)
+{
+	if (str == NULL)
+		return NULL;
+
+	return dc_parser_strndup (parser, str, strlen (str));
+}
+
 int
 dc_parser_isinstance (dc_parser_t *parser, const dc_parser_vtable_t *vtable)
 {
@@ -238,6 +350,66 @@ dc_parser_isinstance (dc_parser_t *parser, const dc_parser_vtable_t *vtable)
 	return parser->vtable == vtable;
 }
 
+void
+dc_parser_checkpoint_add (dc_parser_t *parser, unsigned int time, unsigned int offset, const unsigned int state[], unsigned int nstate)
+{
+	if (parser->spacing == 0 || parser->indexed)
+		return;
+
+	// Keep the checkpoints sorted, and far enough apart. This also
+	// ignores the checkpoints from any repeated pass over the samples.
+	unsigned int next = parser->spacing;
+	if (parser->ncheckpoints)
+		next += parser->checkpoints[parser->ncheckpoints - 1].time;
+	if (time < next)
+		return;
+
+	if (parser->ncheckpoints == parser->capacity) {
+		unsigned int capacity = parser->capacity ? parser->capacity * 2 : 64;
+		dc_parser_checkpoint_t *checkpoints = (dc_parser_checkpoint_t *) realloc (parser->checkpoints, capacity * sizeof (dc_parser_checkpoint_t));
+		if (checkpoints == NULL) {
+			// Without the checkpoint, seeking is just slower.
+			WARNING (parser->context, "Failed to allocate memory.");
+			return;
+		}
+
+		parser->checkpoints = checkpoints;
+		parser->capacity = capacity;
+	}
+
+	dc_parser_checkpoint_t *checkpoint = parser->checkpoints + parser->ncheckpoints;
+	memset (checkpoint, 0, sizeof (dc_parser_checkpoint_t));
+	checkpoint->time = time;
+	checkpoint->offset = offset;
+	for (unsigned int i = 0; i < nstate && i < C_ARRAY_SIZE (checkpoint->state); ++i) {
+		checkpoint->state[i] = state[i];
+	}
+
+	parser->ncheckpoints++;
+}
+
+const dc_parser_checkpoint_t *
+dc_parser_checkpoint_find (dc_parser_t *parser)
+{
+	if (!parser->indexed || parser->begin == 0)
+		return NULL;
+
+	// Find the last checkpoint before the first sample of the window.
+	unsigned int lo = 0, hi = parser->ncheckpoints;
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (parser->checkpoints[mid].time < parser->begin)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0)
+		return NULL;
+
+	return parser->checkpoints + lo - 1;
+}
+
 
 dc_family_t
 dc_parser_get_type (dc_parser_t *parser)
@@ -258,6 +430,11 @@ dc_parser_set_data (dc_parser_t *parser, const unsigned char *data, unsigned int
 	if (parser->vtable->set_data == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
+	dc_parser_arena_reset (parser);
+
+	parser->ncheckpoints = 0;
+	parser->indexed = 0;
+
 	parser->data = data;
 	parser->size = size;
 
@@ -291,15 +468,333 @@ dc_parser_get_field (dc_parser_t *parser, dc_field_type_t type, unsigned int fla
 
 
 dc_status_t
-dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata)
+dc_parser_set_sample_mask (dc_parser_t *parser, unsigned int mask)
 {
+	if (parser == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	parser->samplemask = mask;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+typedef struct sample_filter_t {
+	dc_sample_callback_t callback;
+	void *userdata;
+	unsigned int mask;
+} sample_filter_t;
+
+static void
+sample_filter_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	sample_filter_t *filter = (sample_filter_t *) userdata;
+
+	if (filter->mask & DC_SAMPLE_MASK (type))
+		filter->callback (type, value, filter->userdata);
+}
+
+
+dc_status_t
+dc_parser_set_decimation (dc_parser_t *parser, unsigned int interval)
+{
+	if (parser == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	parser->interval = interval;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+/*
+ * The decimation is applied to the output of the backends. Every sample
+ * is still decoded by the backend, so it does not reduce the parsing
+ * time, only the number of samples that reach the application.
+ */
+
+#define NVALUES 8
+#define NEVENTS 16
+
+typedef struct sample_decimator_t {
+	dc_sample_callback_t callback;
+	void *userdata;
+	unsigned int interval;
+	// Current bucket.
+	unsigned int active;
+	unsigned int bucket;
+	unsigned int time;
+	unsigned int emitted;
+	unsigned int nsamples;
+	// Max depth and min temperature of the bucket.
+	unsigned int have_depth;
+	unsigned int have_temperature;
+	double depth;
+	double temperature;
+	// Values of the most recent sample that reported each type.
+	unsigned int count[DC_SAMPLE_GASMIX + 1];
+	unsigned int stamp[DC_SAMPLE_GASMIX + 1];
+	dc_sample_value_t values[DC_SAMPLE_GASMIX + 1][NVALUES];
+	// All events of the bucket.
+	unsigned int nevents;
+	dc_sample_value_t events[NEVENTS];
+} sample_decimator_t;
+
+static void
+sample_decimator_time (sample_decimator_t *decimator)
+{
+	dc_sample_value_t sample = {0};
+
+	// The time starts the sample, and is emitted only once per bucket.
+	if (decimator->emitted)
+		return;
+
+	sample.time = decimator->time;
+	decimator->callback (DC_SAMPLE_TIME, sample, decimator->userdata);
+	decimator->emitted = 1;
+}
+
+static void
+sample_decimator_flush (sample_decimator_t *decimator)
+{
+	dc_sample_value_t sample = {0};
+
+	if (!decimator->active)
+		return;
+
+	sample_decimator_time (decimator);
+
+	if (decimator->have_depth) {
+		sample.depth = decimator->depth;
+		decimator->callback (DC_SAMPLE_DEPTH, sample, decimator->userdata);
+	}
+
+	if (decimator->have_temperature) {
+		sample.temperature = decimator->temperature;
+		decimator->callback (DC_SAMPLE_TEMPERATURE, sample, decimator->userdata);
+	}
+
+	for (unsigned int type = 0; type <= DC_SAMPLE_GASMIX; ++type) {
+		for (unsigned int i = 0; i < decimator->count[type]; ++i) {
+			decimator->callback (type, decimator->values[type][i], decimator->userdata);
+		}
+		decimator->count[type] = 0;
+	}
+
+	for (unsigned int i = 0; i < decimator->nevents; ++i) {
+		decimator->callback (DC_SAMPLE_EVENT, decimator->events[i], decimator->userdata);
+	}
+
+	decimator->active = 0;
+	decimator->emitted = 0;
+	decimator->have_depth = 0;
+	decimator->have_temperature = 0;
+	decimator->nevents = 0;
+}
+
+static void
+sample_decimator_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	sample_decimator_t *decimator = (sample_decimator_t *) userdata;
+
+	if (type == DC_SAMPLE_TIME) {
+		// Close the bucket once the time crosses its boundary.
+		unsigned int bucket = value.time / decimator->interval;
+		if (decimator->active && bucket != decimator->bucket)
+			sample_decimator_flush (decimator);
+
+		if (!decimator->active) {
+			decimator->active = 1;
+			decimator->bucket = bucket;
+			decimator->time = value.time;
+		}
+
+		decimator->nsamples++;
+		return;
+	}
+
+	// Samples without a preceding time can't be assigned to a bucket.
+	if (!decimator->active)
+		return;
+
+	switch (type) {
+	case DC_SAMPLE_DEPTH:
+		if (!decimator->have_depth || value.depth > decimator->depth)
+			decimator->depth = value.depth;
+		decimator->have_depth = 1;
+		break;
+	case DC_SAMPLE_TEMPERATURE:
+		if (!decimator->have_temperature || value.temperature < decimator->temperature)
+			decimator->temperature = value.temperature;
+		decimator->have_temperature = 1;
+		break;
+	case DC_SAMPLE_EVENT:
+		// Pass the queued events on early rather than dropping any. They
+		// still belong to the bucket's sample, because its time is emitted
+		// first and the remaining values follow at the end of the bucket.
+		if (decimator->nevents == NEVENTS) {
+			sample_decimator_time (decimator);
+			for (unsigned int i = 0; i < decimator->nevents; ++i) {
+				decimator->callback (DC_SAMPLE_EVENT, decimator->events[i], decimator->userdata);
+			}
+			decimator->nevents = 0;
+		}
+		decimator->events[decimator->nevents++] = value;
+		break;
+	case DC_SAMPLE_VENDOR:
+		// The raw vendor data has no meaning once decimated.
+		break;
+	default:
+		if ((unsigned int) type > DC_SAMPLE_GASMIX)
+			break;
+
+		// Keep only the values of the most recent sample.
+		if (decimator->stamp[type] != decimator->nsamples) {
+			decimator->stamp[type] = decimator->nsamples;
+			decimator->count[type] = 0;
+		}
+
+		if (decimator->count[type] < NVALUES)
+			decimator->values[type][decimator->count[type]++] = value;
+		break;
+	}
+}
+
+
+dc_status_t
+dc_parser_set_index (dc_parser_t *parser, unsigned int spacing)
+{
+	if (parser == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (spacing != parser->spacing) {
+		parser->ncheckpoints = 0;
+		parser->indexed = 0;
+	}
+
+	parser->spacing = spacing;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+typedef struct sample_window_t {
+	dc_sample_callback_t callback;
+	void *userdata;
+	unsigned int begin;
+	unsigned int end;
+	unsigned int inside;
+} sample_window_t;
+
+static void
+sample_window_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	sample_window_t *window = (sample_window_t *) userdata;
+
+	if (type == DC_SAMPLE_TIME)
+		window->inside = value.time >= window->begin && value.time <= window->end;
+
+	if (window->inside)
+		window->callback (type, value, window->userdata);
+}
+
+
+static dc_status_t
+dc_parser_samples_window (dc_parser_t *parser, unsigned int begin, unsigned int end, dc_sample_callback_t callback, void *userdata)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
 	if (parser == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	if (parser->vtable->samples_foreach == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return parser->vtable->samples_foreach (parser, callback, userdata);
+	if (callback == NULL)
+		return parser->vtable->samples_foreach (parser, callback, userdata);
+
+	unsigned int mask = parser->samplemask;
+
+	// Drop the unwanted sample types, for the parsers that don't skip
+	// them on their own.
+	sample_filter_t filter = {callback, userdata, parser->samplemask};
+	if (parser->samplemask != DC_SAMPLE_MASK_ALL) {
+		callback = sample_filter_cb;
+		userdata = &filter;
+	}
+
+	// Merge the samples into buckets of the requested interval. The
+	// decimator needs the time samples to find the bucket boundaries,
+	// and the vendor samples are never used.
+	sample_decimator_t *decimator = NULL;
+	if (parser->interval) {
+		decimator = (sample_decimator_t *) malloc (sizeof (sample_decimator_t));
+		if (decimator == NULL) {
+			ERROR (parser->context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+
+		memset (decimator, 0, sizeof (sample_decimator_t));
+		decimator->callback = callback;
+		decimator->userdata = userdata;
+		decimator->interval = parser->interval;
+		callback = sample_decimator_cb;
+		userdata = decimator;
+
+		mask |= DC_SAMPLE_MASK (DC_SAMPLE_TIME);
+		mask &= ~DC_SAMPLE_MASK (DC_SAMPLE_VENDOR);
+	}
+
+	// Drop the samples outside the requested time window. With a complete
+	// seek index, the parsers that support it also skip the samples
+	// before the nearest checkpoint, and stop after the window.
+	sample_window_t window = {callback, userdata, begin, end, begin == 0};
+	if (begin != 0 || end != UINT_MAX) {
+		callback = sample_window_cb;
+		userdata = &window;
+
+		mask |= DC_SAMPLE_MASK (DC_SAMPLE_TIME);
+
+		if (parser->indexed) {
+			parser->begin = begin;
+			parser->end = end;
+		}
+	}
+
+	parser->activemask = mask;
+	status = parser->vtable->samples_foreach (parser, callback, userdata);
+	parser->activemask = DC_SAMPLE_MASK_ALL;
+	parser->begin = 0;
+	parser->end = UINT_MAX;
+
+	// The first successful pass completes the seek index.
+	if (status == DC_STATUS_SUCCESS && parser->spacing)
+		parser->indexed = 1;
+
+	if (decimator) {
+		if (status == DC_STATUS_SUCCESS)
+			sample_decimator_flush (decimator);
+		free (decimator);
+	}
+
+	return status;
+}
+
+
+dc_status_t
+dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata)
+{
+	return dc_parser_samples_window (parser, 0, UINT_MAX, callback, userdata);
+}
+
+
+dc_status_t
+dc_parser_samples_range (dc_parser_t *parser, unsigned int begin, unsigned int end, dc_sample_callback_t callback, void *userdata)
+{
+	if (parser == NULL || begin > end)
+		return DC_STATUS_INVALIDARGS;
+
+	return dc_parser_samples_window (parser, begin, end, callback, userdata);
 }
 
 
@@ -248,7 +248,12 @@ scubapro_g2_device_open(dc_device_t **out, dc_context_t *context, const char *na
 			status = DC_STATUS_IO;
 			goto error_free;
 		}
-		status = dc_usbhid_custom_io(context, id->vendor, id->device);
+		dc_iostream_t *iostream = NULL;
+		status = dc_usbhid_custom_io(&iostream, context, id->vendor, id->device);
+		if (status == DC_STATUS_SUCCESS) {
+			// Collect the transfer statistics.
+			device_statistics_attach ((dc_device_t *) device, iostream);
+		}
 	}
 
 	if (status != DC_STATUS_SUCCESS) {
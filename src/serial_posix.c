@@ -272,6 +272,11 @@ dc_serial_open (dc_iostream_t **out, dc_context_t *context, const char *name)
 	if (_dc_context_custom_io(context))
 		return dc_custom_io_serial_open(out, context, name);
 
+	// Are we replaying a capture file?
+	dc_capture_t *capture = _dc_context_capture (context);
+	if (dc_capture_isreplay (capture))
+		return dc_capture_open (out, context, capture);
+
 	INFO (context, "Open: name=%s", name);
 
 	// Allocate memory.
@@ -29,6 +29,11 @@
 
 #define SZ_PACKET  254
 
+#define TIMEOUT       3000
+#define TIMEOUT_DRAIN 300
+
+#define WINDOW_MAX 8
+
 // SLIP special character codes
 #define END       0xC0
 #define ESC       0xDB
@@ -40,6 +45,9 @@ shearwater_common_open (shearwater_common_device_t *device, dc_context_t *contex
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 
+	// Use lock-step block requests by default.
+	device->window = 1;
+
 	// Open the device.
 	status = dc_serial_open (&device->iostream, context, name);
 	if (status != DC_STATUS_SUCCESS) {
@@ -47,6 +55,9 @@ shearwater_common_open (shearwater_common_device_t *device, dc_context_t *contex
 		return status;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->iostream);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_iostream_configure (device->iostream, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -54,8 +65,8 @@ shearwater_common_open (shearwater_common_device_t *device, dc_context_t *contex
 		goto error_close;
 	}
 
-	// Set the timeout for receiving data (3000ms).
-	status = dc_iostream_set_timeout (device->iostream, 3000);
+	// Set the timeout for receiving data.
+	status = dc_iostream_set_timeout (device->iostream, TIMEOUT);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to set the timeout.");
 		status = DC_STATUS_IO;
@@ -83,57 +94,85 @@ shearwater_common_close (shearwater_common_device_t *device)
 
 
 static int
-shearwater_common_decompress_lre (unsigned char *data, unsigned int size, dc_buffer_t *buffer, unsigned int *isfinal)
+shearwater_common_decompress_lre (const unsigned char *data, unsigned int size, dc_buffer_t *buffer, unsigned int *isfinal)
 {
 	// The RLE decompression algorithm does interpret the binary data as a
 	// stream of 9 bit values. Therefore, the total number of bits needs to be
 	// a multiple of 9 bits.
 	unsigned int nbits = size * 8;
-	if (nbits % 9 != 0)
+	if (nbits % 9 != 0 || size > SZ_PACKET)
 		return -1;
 
+	// Copy the data to a zero padded buffer, such that the bitstream can
+	// always be read 64 bits at a time, without reading past the end.
+	unsigned char input[SZ_PACKET + 8] = {0};
+	memcpy (input, data, size);
+
+	// Extract all 9 bit values, and calculate the size of the
+	// decompressed data in the same pass.
+	unsigned short values[SZ_PACKET * 8 / 9];
+	unsigned int nvalues = 0, length = 0, final = 0;
 	unsigned int offset = 0;
-	while (offset + 9 <= nbits) {
-		// Extract the 9 bit value.
-		unsigned int byte = offset / 8;
-		unsigned int bit  = offset % 8;
-		unsigned int shift = 16 - (bit + 9);
-		unsigned int value = (array_uint16_be (data + byte) >> shift) & 0x1FF;
-
-		// The 9th bit indicates whether the remaining 8 bits represent
-		// a run of zero bytes or not. If the bit is set, the value is
-		// not a run and doesn’t need expansion. If the bit is not set,
-		// the value contains the number of zero bytes in the run. A
-		// zero-length run indicates the end of the compressed stream.
+	while (offset + 9 <= nbits && !final) {
+		// Load the next 64 bits. At most 7 bits of the first byte are
+		// already consumed, so there are always at least 57 valid bits
+		// available, which is enough for 6 values.
+		const unsigned char *p = input + offset / 8;
+		unsigned long long bits = (((unsigned long long) array_uint32_be (p) << 32) |
+			array_uint32_be (p + 4)) << (offset % 8);
+
+		for (unsigned int i = 0; i < 6 && offset + 9 <= nbits; ++i) {
+			unsigned int value = bits >> 55;
+			bits <<= 9;
+			offset += 9;
+
+			// The 9th bit indicates whether the remaining 8 bits represent
+			// a run of zero bytes or not. If the bit is set, the value is
+			// not a run and doesn’t need expansion. If the bit is not set,
+			// the value contains the number of zero bytes in the run. A
+			// zero-length run indicates the end of the compressed stream.
+			if (value == 0) {
+				final = 1;
+				break;
+			}
+
+			values[nvalues++] = value;
+			length += (value & 0x100) ? 1 : value;
+		}
+	}
+
+	// Grow the buffer to its final size. The new space is zero filled,
+	// so the runs of zero bytes need no further processing.
+	unsigned int previous = dc_buffer_get_size (buffer);
+	if (!dc_buffer_resize (buffer, previous + length))
+		return -1;
+
+	// Store the data bytes directly into the output.
+	unsigned char *output = dc_buffer_get_data (buffer) + previous;
+	for (unsigned int i = 0; i < nvalues; ++i) {
+		unsigned int value = values[i];
 		if (value & 0x100) {
-			// Append the data byte directly.
-			unsigned char c = value & 0xFF;
-			if (!dc_buffer_append (buffer, &c, 1))
-				return -1;
-		} else if (value == 0) {
-			// Reached the end of the compressed stream.
-			if (isfinal)
-				*isfinal = 1;
-			break;
+			*output++ = value & 0xFF;
 		} else {
-			// Expand the run with zero bytes.
-			if (!dc_buffer_resize (buffer, dc_buffer_get_size (buffer) + value))
-				return -1;
+			output += value;
 		}
-
-		offset += 9;
 	}
 
+	if (final && isfinal)
+		*isfinal = 1;
+
 	return 0;
 }
 
 
 static int
-shearwater_common_decompress_xor (unsigned char *data, unsigned int size)
+shearwater_common_decompress_xor (unsigned char *data, unsigned int offset, unsigned int size)
 {
 	// Each block of 32 bytes is XOR'ed (in-place) with the previous block,
-	// except for the first block, which is passed through unchanged.
-	for (unsigned int i = 32; i < size; ++i) {
+	// except for the first block, which is passed through unchanged. Only
+	// the bytes starting at the offset are processed, such that the data
+	// can be decompressed incrementally.
+	for (unsigned int i = (offset > 32 ? offset : 32); i < size; ++i) {
 		data[i] ^= data[i - 32];
 	}
 
@@ -279,15 +318,14 @@ done:
 }
 
 
-dc_status_t
-shearwater_common_transfer (shearwater_common_device_t *device, const unsigned char input[], unsigned int isize, unsigned char output[], unsigned int osize, unsigned int *actual)
+static dc_status_t
+shearwater_common_request (shearwater_common_device_t *device, const unsigned char input[], unsigned int isize)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_device_t *abstract = (dc_device_t *) device;
 	unsigned char packet[SZ_PACKET + 4];
-	unsigned int n = 0;
 
-	if (isize > SZ_PACKET || osize > SZ_PACKET)
+	if (isize > SZ_PACKET)
 		return DC_STATUS_INVALIDARGS;
 
 	if (device_is_cancelled (abstract))
@@ -307,12 +345,20 @@ shearwater_common_transfer (shearwater_common_device_t *device, const unsigned c
 		return status;
 	}
 
-	// Return early if no response packet is requested.
-	if (osize == 0) {
-		if (actual)
-			*actual = 0;
-		return DC_STATUS_SUCCESS;
-	}
+	return DC_STATUS_SUCCESS;
+}
+
+
+static dc_status_t
+shearwater_common_response (shearwater_common_device_t *device, unsigned char output[], unsigned int osize, unsigned int *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_device_t *abstract = (dc_device_t *) device;
+	unsigned char packet[SZ_PACKET + 4];
+	unsigned int n = 0;
+
+	if (osize > SZ_PACKET)
+		return DC_STATUS_INVALIDARGS;
 
 	// Receive the response packet.
 	status = shearwater_common_slip_read (device, packet, sizeof (packet), &n);
@@ -342,6 +388,48 @@ shearwater_common_transfer (shearwater_common_device_t *device, const unsigned c
 }
 
 
+dc_status_t
+shearwater_common_transfer (shearwater_common_device_t *device, const unsigned char input[], unsigned int isize, unsigned char output[], unsigned int osize, unsigned int *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (isize > SZ_PACKET || osize > SZ_PACKET)
+		return DC_STATUS_INVALIDARGS;
+
+	// Send the request packet.
+	status = shearwater_common_request (device, input, isize);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	// Return early if no response packet is requested.
+	if (osize == 0) {
+		if (actual)
+			*actual = 0;
+		return DC_STATUS_SUCCESS;
+	}
+
+	// Receive the response packet.
+	return shearwater_common_response (device, output, osize, actual);
+}
+
+
+static void
+shearwater_common_drain (shearwater_common_device_t *device)
+{
+	unsigned char buffer[SZ_PACKET];
+	size_t nbytes = 0;
+
+	// Read and discard data until the device stays silent for a full
+	// timeout period. A single purge is not sufficient, because a late
+	// answer can still arrive afterwards.
+	dc_iostream_set_timeout (device->iostream, TIMEOUT_DRAIN);
+	do {
+		nbytes = 0;
+		dc_iostream_read (device->iostream, buffer, sizeof (buffer), &nbytes);
+	} while (nbytes);
+	dc_iostream_set_timeout (device->iostream, TIMEOUT);
+}
+
 dc_status_t
 shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buffer, unsigned int address, unsigned int size, unsigned int compression, dc_event_progress_t *progress)
 {
@@ -364,6 +452,18 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 	unsigned char req_quit[] = {0x37};
 	unsigned char response[SZ_PACKET];
 
+	// Blocks received out of order are kept until they can be processed.
+	unsigned char blocks[WINDOW_MAX][SZ_PACKET];
+	unsigned int lengths[WINDOW_MAX] = {0};
+	unsigned int valid[WINDOW_MAX] = {0};
+
+	// Number of outstanding block requests.
+	unsigned int window = device->window;
+	if (window < 1)
+		window = 1;
+	if (window > WINDOW_MAX)
+		window = WINDOW_MAX;
+
 	// Erase the current contents of the buffer.
 	if (!dc_buffer_clear (buffer)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
@@ -399,22 +499,64 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 	unsigned int done = 0;
 	unsigned char block = 1;
 	unsigned int nbytes = 0;
+	unsigned int nblocks = 0;
+	unsigned int pending = 0;
 	while (nbytes < size && !done) {
-		// Transfer the block request.
-		req_block[1] = block;
-		rc = shearwater_common_transfer (device, req_block, sizeof (req_block), response, sizeof (response), &n);
-		if (rc != DC_STATUS_SUCCESS) {
-			return rc;
+		// Keep the window filled with block requests. The requests for
+		// blocks beyond the end of the data are discarded afterwards.
+		while (pending < window) {
+			req_block[1] = (unsigned char) (block + pending);
+			rc = shearwater_common_request (device, req_block, sizeof (req_block));
+			if (rc != DC_STATUS_SUCCESS) {
+				return rc;
+			}
+			pending++;
 		}
 
-		// Verify the block header.
-		if (n < 2 || response[0] != 0x76 || response[1] != block) {
-			ERROR (abstract->context, "Unexpected response packet.");
-			return DC_STATUS_PROTOCOL;
+		// Receive block responses until the next block is available. The
+		// block number is used to put the blocks back into the right order.
+		unsigned int idx = nblocks % window;
+		while (!valid[idx]) {
+			rc = shearwater_common_response (device, response, sizeof (response), &n);
+			if (rc != DC_STATUS_SUCCESS && (rc == DC_STATUS_CANCELLED || window == 1)) {
+				return rc;
+			}
+
+			// Verify the block header.
+			unsigned int offset = 0;
+			if (rc == DC_STATUS_SUCCESS && n >= 2)
+				offset = (unsigned char) (response[1] - block);
+			if (rc != DC_STATUS_SUCCESS || n < 2 || response[0] != 0x76 ||
+				offset >= pending || valid[(nblocks + offset) % window])
+			{
+				if (window == 1) {
+					ERROR (abstract->context, "Unexpected response packet.");
+					return DC_STATUS_PROTOCOL;
+				}
+
+				// The firmware does not handle multiple outstanding block
+				// requests correctly. Discard all pending responses and
+				// continue in lock-step mode from the current block.
+				WARNING (abstract->context, "Pipelined block requests failed. Falling back to lock-step mode.");
+				shearwater_common_drain (device);
+				memset (valid, 0, sizeof (valid));
+				device->window = window = 1;
+				pending = 0;
+				break;
+			}
+
+			unsigned int slot = (nblocks + offset) % window;
+			memcpy (blocks[slot], response + 2, n - 2);
+			lengths[slot] = n - 2;
+			valid[slot] = 1;
 		}
 
+		// Request the current block again after a fallback.
+		if (pending == 0)
+			continue;
+
 		// Verify the block length.
-		unsigned int length = n - 2;
+		unsigned int length = lengths[idx];
 		if (nbytes + length > size) {
 			ERROR (abstract->context, "Unexpected packet size.");
 			return DC_STATUS_PROTOCOL;
@@ -428,28 +570,52 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 		}
 
 		if (compression) {
-			if (shearwater_common_decompress_lre (response + 2, length, buffer, &done) != 0) {
+			unsigned int previous = dc_buffer_get_size (buffer);
+
+			if (shearwater_common_decompress_lre (blocks[idx], length, buffer, &done) != 0) {
 				ERROR (abstract->context, "Decompression error (LRE phase).");
 				return DC_STATUS_PROTOCOL;
 			}
+
+			// Undo the XOR encoding of the new data.
+			if (shearwater_common_decompress_xor (dc_buffer_get_data (buffer), previous, dc_buffer_get_size (buffer)) != 0) {
+				ERROR (abstract->context, "Decompression error (XOR phase).");
+				return DC_STATUS_PROTOCOL;
+			}
 		} else {
-			if (!dc_buffer_append (buffer, response + 2, length)) {
+			if (!dc_buffer_append (buffer, blocks[idx], length)) {
 				ERROR (abstract->context, "Insufficient buffer space available.");
 				return DC_STATUS_PROTOCOL;
 			}
 		}
 
+		valid[idx] = 0;
+		pending--;
 		nbytes += length;
+		nblocks++;
 		block++;
 	}
 
-	if (compression) {
-		if (shearwater_common_decompress_xor (dc_buffer_get_data (buffer), dc_buffer_get_size (buffer)) != 0) {
-			ERROR (abstract->context, "Decompression error (XOR phase).");
-			return DC_STATUS_PROTOCOL;
+	// Discard the responses to the block requests beyond the end of the
+	// data. If the firmware does not answer them, the input is drained and
+	// the next download uses lock-step mode.
+	if (pending) {
+		dc_iostream_set_timeout (device->iostream, TIMEOUT_DRAIN);
+		while (pending) {
+			rc = shearwater_common_response (device, response, sizeof (response), &n);
+			if (rc != DC_STATUS_SUCCESS) {
+				WARNING (abstract->context, "Pipelined block requests failed. Falling back to lock-step mode.");
+				shearwater_common_drain (device);
+				device->window = 1;
+				break;
+			}
+			pending--;
 		}
+		dc_iostream_set_timeout (device->iostream, TIMEOUT);
 	}
 
+	INFO (abstract->context, "Download: blocks=%u, window=%u", nblocks, window);
+
 	// Transfer the quit request.
 	rc = shearwater_common_transfer (device, req_quit, sizeof (req_quit), response, 2, &n);
 	if (rc != DC_STATUS_SUCCESS) {
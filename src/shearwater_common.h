@@ -46,6 +46,7 @@ extern "C" {
 typedef struct shearwater_common_device_t {
 	dc_device_t base;
 	dc_iostream_t *iostream;
+	unsigned int window;
 } shearwater_common_device_t;
 
 dc_status_t
@@ -30,6 +30,8 @@
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &shearwater_petrel_device_vtable)
 
+#define WINDOW 4
+
 #define MANIFEST_ADDR 0xE0000000
 #define MANIFEST_SIZE 0x600
 
@@ -101,6 +103,10 @@ shearwater_petrel_device_open (dc_device_t **out, dc_context_t *context, const c
 		goto error_free;
 	}
 
+	// Keep multiple block requests outstanding. If the firmware doesn't
+	// support this, the download falls back to lock-step mode.
+	device->base.window = WINDOW;
+
 	*out = (dc_device_t *) device;
 
 	return DC_STATUS_SUCCESS;
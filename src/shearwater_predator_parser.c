@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
+#include <limits.h>
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
@@ -40,6 +41,8 @@
 	dc_parser_isinstance((parser), &shearwater_predator_parser_vtable) || \
 	dc_parser_isinstance((parser), &shearwater_petrel_parser_vtable))
 
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
 #define SZ_BLOCK   0x80
 #define SZ_SAMPLE_PREDATOR  0x10
 #define SZ_SAMPLE_PETREL    0x20
@@ -250,7 +253,7 @@ add_string(shearwater_predator_parser_t *parser, const char *desc, const char *v
 		if (str->desc)
 			continue;
 		str->desc = desc;
-		str->value = strdup(value);
+		str->value = dc_parser_strdup(&parser->base, value);
 		break;
 	}
 }
@@ -619,6 +622,9 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 	// Get the unit system.
 	unsigned int units = data[8];
 
+	// Get the requested sample types.
+	unsigned int mask = callback ? abstract->activemask : 0;
+
 	// Previous gas mix.
 	unsigned int o2_previous = 0, he_previous = 0;
 
@@ -626,6 +632,16 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 	unsigned int offset = parser->headersize;
 	unsigned int length = size - parser->footersize;
 
+	// Resume from the seek index.
+	unsigned int end = callback ? abstract->end : UINT_MAX;
+	const dc_parser_checkpoint_t *checkpoint = callback ? dc_parser_checkpoint_find (abstract) : NULL;
+	if (checkpoint) {
+		time = checkpoint->time;
+		offset = checkpoint->offset;
+		o2_previous = checkpoint->state[0];
+		he_previous = checkpoint->state[1];
+	}
+
 	while (offset < length) {
 		dc_sample_value_t sample = {0};
 
@@ -635,33 +651,44 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 			continue;
 		}
 
+		// Stop after the requested time window.
+		if (time >= end)
+			break;
+
+		const unsigned int state[] = {o2_previous, he_previous};
+		dc_parser_checkpoint_add (abstract, time, offset, state, C_ARRAY_SIZE (state));
+
 		// Time (seconds).
 		time += 10;
 		sample.time = time;
-		if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
+		if (mask & DC_SAMPLE_MASK (DC_SAMPLE_TIME)) callback (DC_SAMPLE_TIME, sample, userdata);
 
 		// Depth (1/10 m or ft).
-		unsigned int depth = array_uint16_be (data + offset);
-		if (units == IMPERIAL)
-			sample.depth = depth * FEET / 10.0;
-		else
-			sample.depth = depth / 10.0;
-		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
+		if (mask & DC_SAMPLE_MASK (DC_SAMPLE_DEPTH)) {
+			unsigned int depth = array_uint16_be (data + offset);
+			if (units == IMPERIAL)
+				sample.depth = depth * FEET / 10.0;
+			else
+				sample.depth = depth / 10.0;
+			callback (DC_SAMPLE_DEPTH, sample, userdata);
+		}
 
 		// Temperature (°C or °F).
-		int temperature = (signed char) data[offset + 13];
-		if (temperature < 0) {
-			// Fix negative temperatures.
-			temperature += 102;
-			if (temperature > 0) {
-				temperature = 0;
+		if (mask & DC_SAMPLE_MASK (DC_SAMPLE_TEMPERATURE)) {
+			int temperature = (signed char) data[offset + 13];
+			if (temperature < 0) {
+				// Fix negative temperatures.
+				temperature += 102;
+				if (temperature > 0) {
+					temperature = 0;
+				}
 			}
+			if (units == IMPERIAL)
+				sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+			else
+				sample.temperature = temperature;
+			callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 		}
-		if (units == IMPERIAL)
-			sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
-		else
-			sample.temperature = temperature;
-		if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 		// Status flags.
 		unsigned int status = data[offset + 11];
@@ -671,16 +698,16 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 			if ((status & PPO2_EXTERNAL) == 0) {
 #ifdef SENSOR_AVERAGE
 				sample.ppo2 = data[offset + 6] / 100.0;
-				if (callback) callback (DC_SAMPLE_PPO2, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_PPO2)) callback (DC_SAMPLE_PPO2, sample, userdata);
 #else
 				sample.ppo2 = data[offset + 12] * parser->calibration[0];
-				if (callback && (parser->calibrated & 0x01)) callback (DC_SAMPLE_PPO2, sample, userdata);
+				if ((mask & DC_SAMPLE_MASK (DC_SAMPLE_PPO2)) && (parser->calibrated & 0x01)) callback (DC_SAMPLE_PPO2, sample, userdata);
 
 				sample.ppo2 = data[offset + 14] * parser->calibration[1];
-				if (callback && (parser->calibrated & 0x02)) callback (DC_SAMPLE_PPO2, sample, userdata);
+				if ((mask & DC_SAMPLE_MASK (DC_SAMPLE_PPO2)) && (parser->calibrated & 0x02)) callback (DC_SAMPLE_PPO2, sample, userdata);
 
 				sample.ppo2 = data[offset + 15] * parser->calibration[2];
-				if (callback && (parser->calibrated & 0x04)) callback (DC_SAMPLE_PPO2, sample, userdata);
+				if ((mask & DC_SAMPLE_MASK (DC_SAMPLE_PPO2)) && (parser->calibrated & 0x04)) callback (DC_SAMPLE_PPO2, sample, userdata);
 #endif
 			}
 
@@ -694,13 +721,13 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 					sample.setpoint = data[17] / 100.0;
 				}
 			}
-			if (callback) callback (DC_SAMPLE_SETPOINT, sample, userdata);
+			if (mask & DC_SAMPLE_MASK (DC_SAMPLE_SETPOINT)) callback (DC_SAMPLE_SETPOINT, sample, userdata);
 		}
 
 		// CNS
 		if (parser->petrel) {
 			sample.cns = data[offset + 22] / 100.0;
-			if (callback) callback (DC_SAMPLE_CNS, sample, userdata);
+			if (mask & DC_SAMPLE_MASK (DC_SAMPLE_CNS)) callback (DC_SAMPLE_CNS, sample, userdata);
 		}
 
 		// Gaschange.
@@ -714,25 +741,27 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 			}
 
 			sample.gasmix = idx;
-			if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
+			if (mask & DC_SAMPLE_MASK (DC_SAMPLE_GASMIX)) callback (DC_SAMPLE_GASMIX, sample, userdata);
 			o2_previous = o2;
 			he_previous = he;
 		}
 
 		// Deco stop / NDL.
-		unsigned int decostop = array_uint16_be (data + offset + 2);
-		if (decostop) {
-			sample.deco.type = DC_DECO_DECOSTOP;
-			if (units == IMPERIAL)
-				sample.deco.depth = decostop * FEET;
-			else
-				sample.deco.depth = decostop;
-		} else {
-			sample.deco.type = DC_DECO_NDL;
-			sample.deco.depth = 0.0;
+		if (mask & DC_SAMPLE_MASK (DC_SAMPLE_DECO)) {
+			unsigned int decostop = array_uint16_be (data + offset + 2);
+			if (decostop) {
+				sample.deco.type = DC_DECO_DECOSTOP;
+				if (units == IMPERIAL)
+					sample.deco.depth = decostop * FEET;
+				else
+					sample.deco.depth = decostop;
+			} else {
+				sample.deco.type = DC_DECO_NDL;
+				sample.deco.depth = 0.0;
+			}
+			sample.deco.time = data[offset + 9] * 60;
+			callback (DC_SAMPLE_DECO, sample, userdata);
 		}
-		sample.deco.time = data[offset + 9] * 60;
-		if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
 
 		// for logversion 7 and newer (introduced for Perdix AI)
 		// detect tank pressure
@@ -751,14 +780,14 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 				pressure &= 0x0FFF;
 				sample.pressure.tank = 0;
 				sample.pressure.value = pressure * 2 * PSI / BAR;
-				if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_PRESSURE)) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 			}
 			pressure = array_uint16_be (data + offset + 19);
 			if (pressure < 0xFFF0) {
 				pressure &= 0x0FFF;
 				sample.pressure.tank = 1;
 				sample.pressure.value = pressure * 2 * PSI / BAR;
-				if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_PRESSURE)) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 			}
 
 			// Gas time remaining in minutes
@@ -770,7 +799,7 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 			//    0xFB Tank size or max pressure haven’t been set up
 			if (data[offset + 21] < 0xF0) {
 				sample.rbt = data[offset + 21];
-				if (callback) callback (DC_SAMPLE_RBT, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_RBT)) callback (DC_SAMPLE_RBT, sample, userdata);
 			}
 		}
 
@@ -19,7 +19,7 @@
  * MA 02110-1301 USA
  */
 
-#include <stdlib.h> // malloc
+#include <stdlib.h> // malloc, realloc
 #include <string.h> // memcmp, memcpy
 #include <assert.h> // assert
 
@@ -34,6 +34,10 @@
 
 #define SZ_VERSION    0x04
 #define SZ_PACKET     0x78
+// Twice the default packet size. This is the largest multiple of the
+// default packet size that still fits in the single byte length field
+// of the read command. It is not documented by the manufacturer.
+#define SZ_PACKET_MAX 0xF0
 #define SZ_MINIMUM    8
 
 #define RB_PROFILE_DISTANCE(l,a,b,m)  ringbuffer_distance (a, b, m, l->rb_profile_begin, l->rb_profile_end)
@@ -46,15 +50,19 @@ suunto_common2_device_init (suunto_common2_device_t *device)
 	assert (device != NULL);
 
 	// Set the default values.
+	device->iostream = NULL;
 	device->layout = NULL;
 	memset (device->version, 0, sizeof (device->version));
 	memset (device->fingerprint, 0, sizeof (device->fingerprint));
+	device->packetsize = 0;
 }
 
 
 static dc_status_t
 suunto_common2_transfer (dc_device_t *abstract, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int size)
 {
+	suunto_common2_device_t *device = (suunto_common2_device_t *) abstract;
+
 	assert (asize >= size + 4);
 
 	if (VTABLE (abstract)->packet == NULL)
@@ -76,6 +84,13 @@ suunto_common2_transfer (dc_device_t *abstract, const unsigned char command[], u
 		// Abort if the maximum number of retries is reached.
 		if (nretries++ >= MAXRETRIES)
 			return rc;
+
+		device_statistics_retry (abstract);
+
+		// Discard the remainder of a late answer, to prevent it from
+		// being mistaken for the echo of the next command.
+		dc_iostream_sleep (device->iostream, 100);
+		dc_iostream_purge (device->iostream, DC_DIRECTION_INPUT);
 	}
 
 	return rc;
@@ -132,18 +147,61 @@ suunto_common2_device_reset_maxdepth (dc_device_t *abstract)
 }
 
 
+static unsigned int
+suunto_common2_device_packetsize (dc_device_t *abstract)
+{
+	suunto_common2_device_t *device = (suunto_common2_device_t *) abstract;
+
+	if (device->packetsize)
+		return device->packetsize;
+
+	if (VTABLE (abstract)->packet == NULL)
+		return SZ_PACKET;
+
+	// The official application always requests packets of SZ_PACKET
+	// bytes, but the protocol allows larger packets. Probe once (without
+	// retries) whether the firmware accepts them, and fall back to the
+	// default packet size if it does not.
+	unsigned int len = SZ_PACKET_MAX;
+	unsigned char answer[SZ_PACKET_MAX + 7] = {0};
+	unsigned char command[7] = {0x05, 0x00, 0x03, 0x00, 0x00, len, 0};
+	command[6] = checksum_xor_uint8 (command, 6, 0x00);
+	dc_status_t rc = VTABLE (abstract)->packet (abstract, command, sizeof (command), answer, len + 7, len);
+	if (rc == DC_STATUS_SUCCESS) {
+		device->packetsize = SZ_PACKET_MAX;
+	} else if (rc == DC_STATUS_TIMEOUT || rc == DC_STATUS_PROTOCOL) {
+		// Discard the remainder of a late or partial answer, to prevent
+		// it from being mistaken for the echo of the next command.
+		dc_iostream_sleep (device->iostream, 100);
+		dc_iostream_purge (device->iostream, DC_DIRECTION_INPUT);
+		device->packetsize = SZ_PACKET;
+	} else {
+		// Don't cache the result for other errors (e.g. cancellation).
+		return SZ_PACKET;
+	}
+
+	DEBUG (abstract->context, "Using a packet size of %u bytes.", device->packetsize);
+
+	return device->packetsize;
+}
+
+
 dc_status_t
 suunto_common2_device_read (dc_device_t *abstract, unsigned int address, unsigned char data[], unsigned int size)
 {
+	suunto_common2_device_t *device = (suunto_common2_device_t *) abstract;
+
+	unsigned int packetsize = device->packetsize ? device->packetsize : SZ_PACKET;
+
 	unsigned int nbytes = 0;
 	while (nbytes < size) {
 		// Calculate the package size.
 		unsigned int len = size - nbytes;
-		if (len > SZ_PACKET)
-			len = SZ_PACKET;
+		if (len > packetsize)
+			len = packetsize;
 
 		// Read the package.
-		unsigned char answer[SZ_PACKET + 7] = {0};
+		unsigned char answer[SZ_PACKET_MAX + 7] = {0};
 		unsigned char command[7] = {0x05, 0x00, 0x03,
 				(address >> 8) & 0xFF, // high
 				(address     ) & 0xFF, // low
@@ -197,6 +255,175 @@ suunto_common2_device_write (dc_device_t *abstract, unsigned int address, const
 }
 
 
+static void
+suunto_common2_device_devinfo (dc_device_t *abstract, const unsigned char serial[])
+{
+	suunto_common2_device_t *device = (suunto_common2_device_t*) abstract;
+
+	// Emit a device info event.
+	dc_event_devinfo_t devinfo;
+	devinfo.model = device->version[0];
+	devinfo.firmware = array_uint24_be (device->version + 1);
+	devinfo.serial = 0;
+	for (unsigned int i = 0; i < 4; ++i) {
+		devinfo.serial *= 100;
+		devinfo.serial += serial[i];
+	}
+	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+}
+
+
+static int
+suunto_common2_rb_valid (const suunto_common2_layout_t *layout, unsigned int address)
+{
+	return address >= layout->rb_profile_begin && address < layout->rb_profile_end;
+}
+
+
+static unsigned int
+suunto_common2_rb_uint16 (const suunto_common2_layout_t *layout, const unsigned char data[], unsigned int address, unsigned int offset)
+{
+	unsigned int lo = ringbuffer_increment (address, offset, layout->rb_profile_begin, layout->rb_profile_end);
+	unsigned int hi = ringbuffer_increment (lo, 1, layout->rb_profile_begin, layout->rb_profile_end);
+	return data[lo] | (data[hi] << 8);
+}
+
+
+static dc_status_t
+suunto_common2_device_dump_delta (dc_device_t *abstract, unsigned char data[], unsigned int size, const unsigned char cache[], unsigned int packetsize)
+{
+	suunto_common2_device_t *device = (suunto_common2_device_t*) abstract;
+	const suunto_common2_layout_t *layout = device->layout;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	// Enable progress notifications.
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	progress.maximum = size;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	// Start from the cached memory image.
+	memcpy (data, cache, size);
+
+	// Re-read everything outside the profile ringbuffer.
+	rc = device_dump_read_range (abstract, &progress, data, size, 0, layout->rb_profile_begin, 1, packetsize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	rc = device_dump_read_range (abstract, &progress, data, size, layout->rb_profile_end, size, 1, packetsize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	const unsigned char *header = data + 0x0190;
+	const unsigned char *oldheader = cache + 0x0190;
+	unsigned int last     = array_uint16_le (header + 0);
+	unsigned int count    = array_uint16_le (header + 2);
+	unsigned int end      = array_uint16_le (header + 4);
+	unsigned int begin    = array_uint16_le (header + 6);
+	unsigned int oldlast  = array_uint16_le (oldheader + 0);
+	unsigned int oldcount = array_uint16_le (oldheader + 2);
+	unsigned int oldend   = array_uint16_le (oldheader + 4);
+	unsigned int oldbegin = array_uint16_le (oldheader + 6);
+	if (!suunto_common2_rb_valid (layout, last) ||
+		!suunto_common2_rb_valid (layout, end) ||
+		!suunto_common2_rb_valid (layout, begin) ||
+		!suunto_common2_rb_valid (layout, oldlast) ||
+		!suunto_common2_rb_valid (layout, oldend) ||
+		!suunto_common2_rb_valid (layout, oldbegin))
+	{
+		WARNING (abstract->context, "Invalid ringbuffer pointers detected. Downloading the entire ringbuffer.");
+		goto full;
+	}
+
+	// The cached dives can only be kept if less than one full lap of the
+	// ringbuffer was written since the cache was made. In that case, the
+	// most recent cached dive is still present unchanged on the device.
+	if (oldcount) {
+		unsigned int length = layout->fingerprint + 4 + sizeof (device->fingerprint);
+		unsigned int probe = ringbuffer_increment (oldlast, length, layout->rb_profile_begin, layout->rb_profile_end);
+		rc = device_dump_read_ringbuffer (abstract, &progress, data, size,
+			layout->rb_profile_begin, layout->rb_profile_end,
+			oldlast, probe, 1, packetsize);
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+
+		for (unsigned int i = 0; i < length; ++i) {
+			unsigned int offset = ringbuffer_increment (oldlast, i, layout->rb_profile_begin, layout->rb_profile_end);
+			if (data[offset] != cache[offset]) {
+				WARNING (abstract->context, "Cached dives overwritten. Downloading the entire ringbuffer.");
+				goto full;
+			}
+		}
+	}
+
+	// Nothing else changed if the ringbuffer pointers are unchanged.
+	if (memcmp (header, oldheader, 8) == 0)
+		goto done;
+
+	if (count == 0)
+		goto done;
+
+	// Count the cached dives that were removed from the start of the
+	// ringbuffer, by following their next pointers.
+	unsigned int nremoved = 0;
+	unsigned int current = oldbegin;
+	while (current != begin) {
+		if (nremoved >= oldcount) {
+			WARNING (abstract->context, "All cached dives removed. Downloading the entire ringbuffer.");
+			goto full;
+		}
+		current = suunto_common2_rb_uint16 (layout, cache, current, 2);
+		nremoved++;
+	}
+
+	// Only the data between the old and the new end pointer can have
+	// changed.
+	rc = device_dump_read_ringbuffer (abstract, &progress, data, size,
+		layout->rb_profile_begin, layout->rb_profile_end,
+		oldend, end, 1, packetsize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// Count the new dives, by following their previous pointers back to
+	// the old end pointer. Together with the removed dives, they must
+	// account for the new number of dives.
+	unsigned int nadded = 0;
+	unsigned int length = RB_PROFILE_DISTANCE (layout, oldend, end, 0);
+	current = last;
+	while (length) {
+		if (nadded >= count ||
+			RB_PROFILE_DISTANCE (layout, oldend, current, 0) >= length) {
+			WARNING (abstract->context, "Unexpected new dives. Downloading the entire ringbuffer.");
+			goto full;
+		}
+		nadded++;
+		if (current == oldend)
+			break;
+		current = suunto_common2_rb_uint16 (layout, data, current, 0);
+	}
+
+	if (count != oldcount + nadded - nremoved) {
+		WARNING (abstract->context, "Unexpected number of dives (%u %u %u %u). Downloading the entire ringbuffer.",
+			oldcount, nadded, nremoved, count);
+		goto full;
+	}
+
+	goto done;
+
+full:
+	progress.maximum = progress.current + (layout->rb_profile_end - layout->rb_profile_begin);
+	rc = device_dump_read_range (abstract, &progress, data, size, layout->rb_profile_begin, layout->rb_profile_end, 1, packetsize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+done:
+	// Update and emit a progress event.
+	progress.maximum = progress.current;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 dc_status_t
 suunto_common2_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 {
@@ -205,21 +432,45 @@ suunto_common2_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	assert (device != NULL);
 	assert (device->layout != NULL);
 
+	const suunto_common2_layout_t *layout = device->layout;
+
 	// Erase the current contents of the buffer and
 	// allocate the required amount of memory.
-	if (!dc_buffer_clear (buffer) || !dc_buffer_resize (buffer, device->layout->memsize)) {
+	if (!dc_buffer_clear (buffer) || !dc_buffer_resize (buffer, layout->memsize)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_NOMEMORY;
 	}
 
+	unsigned char *data = dc_buffer_get_data (buffer);
+	unsigned int size = dc_buffer_get_size (buffer);
+
 	// Emit a vendor event.
 	dc_event_vendor_t vendor;
 	vendor.data = device->version;
 	vendor.size = sizeof (device->version);
 	device_event_emit (abstract, DC_EVENT_VENDOR, &vendor);
 
-	return device_dump_read (abstract, dc_buffer_get_data (buffer),
-		dc_buffer_get_size (buffer), SZ_PACKET);
+	// Use the largest packet size supported by the firmware.
+	unsigned int packetsize = suunto_common2_device_packetsize (abstract);
+
+	// Read the serial number.
+	dc_status_t rc = suunto_common2_device_read (abstract, layout->serial, data + layout->serial, SZ_MINIMUM > 4 ? SZ_MINIMUM : 4);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to read the memory header.");
+		return rc;
+	}
+
+	// Emit a device info event. This gives the application the
+	// opportunity to register the memory cache for this device.
+	suunto_common2_device_devinfo (abstract, data + layout->serial);
+
+	// The memory cache can only be used if it belongs to the same device.
+	const unsigned char *cache = device_cache_get (abstract, size);
+	if (cache == NULL || memcmp (cache + layout->serial, data + layout->serial, 4) != 0) {
+		return device_dump_read (abstract, data, size, packetsize);
+	}
+
+	return suunto_common2_device_dump_delta (abstract, data, size, cache, packetsize);
 }
 
 
@@ -261,15 +512,7 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
 	// Emit a device info event.
-	dc_event_devinfo_t devinfo;
-	devinfo.model = device->version[0];
-	devinfo.firmware = array_uint24_be (device->version + 1);
-	devinfo.serial = 0;
-	for (unsigned int i = 0; i < 4; ++i) {
-		devinfo.serial *= 100;
-		devinfo.serial += serial[i];
-	}
-	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+	suunto_common2_device_devinfo (abstract, serial);
 
 	// Read the header bytes.
 	unsigned char header[8] = {0};
@@ -303,21 +546,21 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 	progress.current += sizeof (header);
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
+	// Use the largest packet size supported by the firmware.
+	unsigned int packetsize = suunto_common2_device_packetsize (abstract);
+
 	// Create the ringbuffer stream.
 	dc_rbstream_t *rbstream = NULL;
-	rc = dc_rbstream_new (&rbstream, abstract, 1, SZ_PACKET, layout->rb_profile_begin, layout->rb_profile_end, end);
+	rc = dc_rbstream_new (&rbstream, abstract, 1, packetsize, layout->rb_profile_begin, layout->rb_profile_end, end);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to create the ringbuffer stream.");
 		return rc;
 	}
 
-	// Memory buffer to store all the dives.
-	unsigned char *data = (unsigned char *) malloc (layout->rb_profile_end - layout->rb_profile_begin);
-	if (data == NULL) {
-		ERROR (abstract->context, "Failed to allocate memory.");
-		dc_rbstream_free (rbstream);
-		return DC_STATUS_NOMEMORY;
-	}
+	// Memory buffer for a single dive. Because the dives are processed
+	// one at a time, the buffer only needs to grow to the largest dive.
+	unsigned char *data = NULL;
+	unsigned int capacity = 0;
 
 	// The ring buffer is traversed backwards to retrieve the most recent
 	// dives first. This allows us to download only the new dives.
@@ -338,8 +581,21 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 		// Move to the begin of the current dive.
 		offset -= size;
 
+		// Grow the buffer if necessary.
+		if (size > capacity) {
+			unsigned char *tmp = (unsigned char *) realloc (data, size);
+			if (tmp == NULL) {
+				ERROR (abstract->context, "Failed to allocate memory.");
+				dc_rbstream_free (rbstream);
+				free (data);
+				return DC_STATUS_NOMEMORY;
+			}
+			data = tmp;
+			capacity = size;
+		}
+
 		// Read the dive.
-		rc = dc_rbstream_read (rbstream, &progress, data + offset, size);
+		rc = dc_rbstream_read (rbstream, &progress, data, size);
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to read the dive.");
 			dc_rbstream_free (rbstream);
@@ -347,7 +603,7 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 			return rc;
 		}
 
-		unsigned char *p = data + offset;
+		unsigned char *p = data;
 		unsigned int prev = array_uint16_le (p + 0);
 		unsigned int next = array_uint16_le (p + 2);
 		if (prev < layout->rb_profile_begin ||
@@ -367,8 +623,11 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 			return DC_STATUS_DATAFORMAT;
 		}
 
-		if (next != current) {
-			unsigned int fp_offset = layout->fingerprint + 4;
+		unsigned int fp_offset = layout->fingerprint + 4;
+		if (next != current && size < fp_offset + sizeof (device->fingerprint)) {
+			ERROR (abstract->context, "Skipping truncated dive (0x%04x 0x%04x %u).", current, next, size);
+			status = DC_STATUS_DATAFORMAT;
+		} else if (next != current) {
 			if (memcmp (p + fp_offset, device->fingerprint, sizeof (device->fingerprint)) == 0) {
 				dc_rbstream_free (rbstream);
 				free (data);
@@ -42,9 +42,11 @@ typedef struct suunto_common2_layout_t {
 
 typedef struct suunto_common2_device_t {
 	dc_device_t base;
+	dc_iostream_t *iostream;
 	const suunto_common2_layout_t *layout;
 	unsigned char version[4];
 	unsigned char fingerprint[7];
+	unsigned int packetsize;
 } suunto_common2_device_t;
 
 typedef struct suunto_common2_device_vtable_t {
@@ -44,7 +44,6 @@
 
 typedef struct suunto_d9_device_t {
 	suunto_common2_device_t base;
-	dc_iostream_t *iostream;
 } suunto_d9_device_t;
 
 static dc_status_t suunto_d9_device_packet (dc_device_t *abstract, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int size);
@@ -111,7 +110,7 @@ suunto_d9_device_autodetect (suunto_d9_device_t *device, unsigned int model)
 		unsigned int idx = (hint + i) % C_ARRAY_SIZE(baudrates);
 
 		// Adjust the baudrate.
-		status = dc_iostream_configure (device->iostream, baudrates[idx], 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
+		status = dc_iostream_configure (device->base.iostream, baudrates[idx], 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 		if (status != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to set the terminal attributes.");
 			return status;
@@ -146,42 +145,42 @@ suunto_d9_device_open (dc_device_t **out, dc_context_t *context, const char *nam
 	// Initialize the base class.
 	suunto_common2_device_init (&device->base);
 
-	// Set the default values.
-	device->iostream = NULL;
-
 	// Open the device.
-	status = dc_serial_open (&device->iostream, context, name);
+	status = dc_serial_open (&device->base.iostream, context, name);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to open the serial port.");
 		goto error_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->base.iostream);
+
 	// Set the serial communication protocol (9600 8N1).
-	status = dc_iostream_configure (device->iostream, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
+	status = dc_iostream_configure (device->base.iostream, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to set the terminal attributes.");
 		goto error_close;
 	}
 
 	// Set the timeout for receiving data (3000 ms).
-	status = dc_iostream_set_timeout (device->iostream, 3000);
+	status = dc_iostream_set_timeout (device->base.iostream, 3000);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to set the timeout.");
 		goto error_close;
 	}
 
 	// Set the DTR line (power supply for the interface).
-	status = dc_iostream_set_dtr (device->iostream, 1);
+	status = dc_iostream_set_dtr (device->base.iostream, 1);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to set the DTR line.");
 		goto error_close;
 	}
 
 	// Give the interface 100 ms to settle and draw power up.
-	dc_iostream_sleep (device->iostream, 100);
+	dc_iostream_sleep (device->base.iostream, 100);
 
 	// Make sure everything is in a sane state.
-	dc_iostream_purge (device->iostream, DC_DIRECTION_ALL);
+	dc_iostream_purge (device->base.iostream, DC_DIRECTION_ALL);
 
 	// Try to autodetect the protocol variant.
 	status = suunto_d9_device_autodetect (device, model);
@@ -206,7 +205,7 @@ suunto_d9_device_open (dc_device_t **out, dc_context_t *context, const char *nam
 	return DC_STATUS_SUCCESS;
 
 error_close:
-	dc_iostream_close (device->iostream);
+	dc_iostream_close (device->base.iostream);
 error_free:
 	dc_device_deallocate ((dc_device_t *) device);
 	return status;
@@ -221,7 +220,7 @@ suunto_d9_device_close (dc_device_t *abstract)
 	dc_status_t rc = DC_STATUS_SUCCESS;
 
 	// Close the device.
-	rc = dc_iostream_close (device->iostream);
+	rc = dc_iostream_close (device->base.iostream);
 	if (rc != DC_STATUS_SUCCESS) {
 		dc_status_set_error(&status, rc);
 	}
@@ -240,14 +239,14 @@ suunto_d9_device_packet (dc_device_t *abstract, const unsigned char command[], u
 		return DC_STATUS_CANCELLED;
 
 	// Clear RTS to send the command.
-	status = dc_iostream_set_rts (device->iostream, 0);
+	status = dc_iostream_set_rts (device->base.iostream, 0);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to clear RTS.");
 		return status;
 	}
 
 	// Send the command to the dive computer.
-	status = dc_iostream_write (device->iostream, command, csize, NULL);
+	status = dc_iostream_write (device->base.iostream, command, csize, NULL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to send the command.");
 		return status;
@@ -256,7 +255,7 @@ suunto_d9_device_packet (dc_device_t *abstract, const unsigned char command[], u
 	// Receive the echo.
 	unsigned char echo[128] = {0};
 	assert (sizeof (echo) >= csize);
-	status = dc_iostream_read (device->iostream, echo, csize, NULL);
+	status = dc_iostream_read (device->base.iostream, echo, csize, NULL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to receive the echo.");
 		return status;
@@ -269,14 +268,14 @@ suunto_d9_device_packet (dc_device_t *abstract, const unsigned char command[], u
 	}
 
 	// Set RTS to receive the reply.
-	status = dc_iostream_set_rts (device->iostream, 1);
+	status = dc_iostream_set_rts (device->base.iostream, 1);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to set RTS.");
 		return status;
 	}
 
 	// Receive the answer of the dive computer.
-	status = dc_iostream_read (device->iostream, answer, asize, NULL);
+	status = dc_iostream_read (device->base.iostream, answer, asize, NULL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to receive the answer.");
 		return status;
@@ -22,13 +22,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <zlib.h>	/* For crc32() */
 
 #include "suunto_eonsteel.h"
 #include "context-private.h"
 #include "device-private.h"
 #include "array.h"
 #include "usbhid.h"
+#include "hdlc.h"
 #include "platform.h"
 
 #define EONSTEEL 0
@@ -179,76 +179,30 @@ static int receive_usbhid_packet(dc_custom_io_t *io, suunto_eonsteel_device_t *e
 
 static int fill_ble_buffer(dc_custom_io_t *io, suunto_eonsteel_device_t *eon, unsigned char *buffer, int size)
 {
-	int state = 0;
-	int bytes = 0;
-	unsigned int crc;
+	hdlc_decoder_t decoder;
+	unsigned int bytes = 0;
+
+	hdlc_decoder_init(&decoder, eon->base.context, buffer, size);
 
 	for (;;) {
 		unsigned char packet[32];
 		dc_status_t rc = DC_STATUS_SUCCESS;
 		size_t transferred = 0;
-		int i;
 
 		rc = io->packet_read(io, packet, sizeof(packet), &transferred);
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR(eon->base.context, "BLE GATT read transfer failed");
 			return -1;
 		}
-		for (i = 0; i < transferred; i++) {
-			unsigned char c = packet[i];
-
-			if (c == 0x7e) {
-				if (state == 1)
-					goto done;
-				if (state == 2) {
-					ERROR(eon->base.context, "BLE GATT stream has escaped 7e character");
-					return -1;
-				}
-				/* Initial 7e character - good */
-				state = 1;
-				continue;
-			}
-
-			if (!state) {
-				ERROR(eon->base.context, "BLE GATT stream did not start with 7e");
-				return -1;
-			}
-
-			if (c == 0x7d) {
-				if (state == 2) {
-					ERROR(eon->base.context, "BLE GATT stream has escaped 7d character");
-					return -1;
-				}
-				state = 2;
-				continue;
-			}
 
-			if (state == 2) {
-				c ^= 0x20;
-				state = 1;
-			}
-			if (bytes < size)
-				buffer[bytes] = c;
-			bytes++;
-		}
-	}
-done:
-	if (bytes < 4) {
-		ERROR(eon->base.context, "did not receive BLE CRC32 data");
-		return -1;
-	}
-	if (bytes > size) {
-		ERROR(eon->base.context, "BLE GATT stream too long (%d bytes, buffer is %d)", bytes, size);
-		return -1;
+		/* Unescape and check the CRC in a single pass */
+		rc = hdlc_decoder_push(&decoder, packet, transferred, NULL, &bytes);
+		if (rc == DC_STATUS_DONE)
+			break;
+		if (rc != DC_STATUS_SUCCESS)
+			return -1;
 	}
 
-	/* Remove and check CRC */
-	bytes -= 4;
-	crc = crc32(0, buffer, bytes);
-	if (crc != array_uint32_le(buffer + bytes)) {
-		ERROR(eon->base.context, "incorrect BLE CRC32 data");
-		return -1;
-	}
 	HEXDUMP (eon->base.context, DC_LOGLEVEL_DEBUG, "rcv", buffer, bytes);
 	return bytes;
 }
@@ -294,42 +248,6 @@ static int receive_packet(dc_custom_io_t *io, suunto_eonsteel_device_t *eon, uns
 	return receive_usbhid_packet(io, eon, buffer, size);
 }
 
-static int add_hdlc(unsigned char *dst, unsigned char val)
-{
-	int chars = 1;
-	switch (val) {
-	case 0x7e: case 0x7d:
-		*dst++ = 0x7d;
-		val ^= 0x20;
-		chars++;
-		/* fallthrough */
-	default:
-		*dst = val;
-	}
-	return chars;
-}
-
-static int hdlc_reencode(unsigned char *dst, unsigned char *src, int len)
-{
-	unsigned int crc = crc32(0, src, len);
-	int result = 0, i;
-
-	*dst++ = 0x7e; result++;
-	for (i = 0; i < len; i++) {
-		int chars = add_hdlc(dst, src[i]);
-		dst += chars;
-		result += chars;
-	}
-	for (i = 0; i < 4; i++) {
-		int chars = add_hdlc(dst, crc & 255);
-		dst += chars;
-		result += chars;
-		crc >>= 8;
-	}
-	*dst++ = 0x7e; result++;
-	return result;
-}
-
 static int send_cmd(suunto_eonsteel_device_t *eon,
 	unsigned short cmd,
 	unsigned int len,
@@ -373,10 +291,10 @@ static int send_cmd(suunto_eonsteel_device_t *eon,
 	// BLE GATT protocol?
 	if (io->packet_size < 64) {
 		int hdlc_len;
-		unsigned char hdlc[2+2*(62+4)]; /* start/stop + escaping*(maxbuf+crc32) */
+		unsigned char hdlc[HDLC_ENCODED_SIZE(62)];
 		unsigned char *ptr;
 
-		hdlc_len = hdlc_reencode(hdlc, buf+2, buf[1]);
+		hdlc_len = hdlc_encode(hdlc, sizeof(hdlc), buf+2, buf[1]);
 
 		ptr = hdlc;
 		do {
@@ -769,7 +687,12 @@ suunto_eonsteel_device_open(dc_device_t **out, dc_context_t *context, const char
 		/* We really need some way to specify USB ID's in the descriptor */
 		unsigned int vendor_id = 0x1493;
 		unsigned int device_id = model ? 0x0033 : 0x0030;
-		status = dc_usbhid_custom_io(context, vendor_id, device_id);
+		dc_iostream_t *iostream = NULL;
+		status = dc_usbhid_custom_io(&iostream, context, vendor_id, device_id);
+		if (status == DC_STATUS_SUCCESS) {
+			// Collect the transfer statistics.
+			device_statistics_attach ((dc_device_t *) eon, iostream);
+		}
 	}
 
 	if (status != DC_STATUS_SUCCESS) {
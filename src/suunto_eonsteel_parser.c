@@ -75,9 +75,13 @@ struct type_desc {
 	const char *desc, *format, *mod;
 	unsigned int size;
 	enum eon_sample type[EON_MAX_GROUP];
+	// The definition in the dive data, and the decoded enum strings.
+	const char *name;
+	const char **enums;
 };
 
 #define MAXTYPE 512
+#define MAXENUM 100
 #define MAXGASES 16
 #define MAXSTRINGS 32
 
@@ -281,22 +285,18 @@ static int fill_in_desc_details(suunto_eonsteel_parser_t *eon, struct type_desc
 	return 0;
 }
 
-static void
-desc_free (struct type_desc desc[], unsigned int count)
-{
-	for (unsigned int i = 0; i < count; ++i) {
-		free((void *)desc[i].desc);
-		free((void *)desc[i].format);
-		free((void *)desc[i].mod);
-	}
-}
-
 static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const char *name, int namelen)
 {
 	struct type_desc desc;
 	const char *next;
 
+	// The type descriptions are recorded only once per dive. Every
+	// following pass over the same data finds the same definition.
+	if (type < MAXTYPE && eon->type_desc[type].name == name)
+		return 0;
+
 	memset(&desc, 0, sizeof(desc));
+	desc.name = name;
 	do {
 		int len;
 		char *p;
@@ -315,14 +315,11 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			ERROR(eon->base.context, "Unexpected type description: %.*s", len, name);
 			return -1;
 		}
-		p = (char *) malloc(len-4);
+		p = dc_parser_strndup(&eon->base, name+5, len-5);
 		if (!p) {
 			ERROR(eon->base.context, "out of memory");
-			desc_free(&desc, 1);
 			return -1;
 		}
-		memcpy(p, name+5, len-5);
-		p[len-5] = 0;
 
 		// PTH, GRP, FRM, MOD
 		switch (name[1]) {
@@ -338,8 +335,6 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			break;
 		default:
 			ERROR(eon->base.context, "Unknown type descriptor: %.*s", len, name);
-			desc_free(&desc, 1);
-			free(p);
 			return -1;
 		}
 	} while ((name = next) != NULL);
@@ -350,13 +345,11 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			desc.desc ? desc.desc : "",
 			desc.format ? desc.format : "",
 			desc.mod ? desc.mod : "");
-		desc_free(&desc, 1);
 		return -1;
 	}
 
 	fill_in_desc_details(eon, &desc);
 
-	desc_free(eon->type_desc + type, 1);
 	eon->type_desc[type] = desc;
 	return 0;
 }
@@ -608,21 +601,19 @@ static void sample_gas_switch_event(struct sample_data *info, unsigned short idx
  *
  * "enum:0=NoFly Time,1=Depth,2=Surface Time,3=..."
  */
-static const char *lookup_enum(const struct type_desc *desc, unsigned char value)
+static const char **decode_enums(suunto_eonsteel_parser_t *eon, const char *str)
 {
-	const char *str = desc->format;
+	const char **enums;
 	unsigned char c;
 
-	if (!str)
-		return NULL;
-	if (strncmp(str, "enum:", 5))
+	enums = (const char **) dc_parser_alloc(&eon->base, MAXENUM * sizeof(*enums));
+	if (!enums)
 		return NULL;
-	str += 5;
+	memset(enums, 0, MAXENUM * sizeof(*enums));
 
 	while ((c = *str) != 0) {
 		unsigned char n;
 		const char *begin, *end;
-		char *ret;
 
 		str++;
 		if (!isdigit(c))
@@ -648,19 +639,49 @@ static const char *lookup_enum(const struct type_desc *desc, unsigned char value
 			continue;
 		begin++;
 
-		// Is it the value we're looking for?
-		if (n != value)
+		// The first match wins, like in a sequential lookup.
+		if (enums[n])
 			continue;
 
-		ret = (char *)malloc(end - begin + 1);
-		if (!ret)
-			break;
+		enums[n] = dc_parser_strndup(&eon->base, begin, end - begin);
+		if (!enums[n])
+			return NULL;
+	}
+
+	return enums;
+}
 
-		memcpy(ret, begin, end-begin);
-		ret[end-begin] = 0;
-		return ret;
+/*
+ * Look up the string from an enumeration.
+ *
+ * Enumerations have the enum values in the "format" string,
+ * and all start with "enum:" followed by a comma-separated list
+ * of enumeration values and strings. Example:
+ *
+ * "enum:0=NoFly Time,1=Depth,2=Surface Time,3=..."
+ *
+ * The strings are decoded once per type descriptor, because the
+ * lookups happen for every sample, and every pass over the samples.
+ */
+static const char *lookup_enum(suunto_eonsteel_parser_t *eon, const struct type_desc *desc, unsigned char value)
+{
+	const char *str = desc->format;
+	struct type_desc *cache = eon->type_desc + (desc - eon->type_desc);
+
+	if (!str)
+		return NULL;
+	if (strncmp(str, "enum:", 5))
+		return NULL;
+	if (value >= MAXENUM)
+		return NULL;
+
+	if (!cache->enums) {
+		cache->enums = decode_enums(eon, str + 5);
+		if (!cache->enums)
+			return NULL;
 	}
-	return NULL;
+
+	return cache->enums[value];
 }
 
 /*
@@ -669,7 +690,7 @@ static const char *lookup_enum(const struct type_desc *desc, unsigned char value
  */
 static void sample_event_state_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->state_type = lookup_enum(desc, type);
+	info->state_type = lookup_enum(info->eon, desc, type);
 }
 
 static void sample_event_state_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -691,7 +712,7 @@ static void sample_event_state_value(const struct type_desc *desc, struct sample
 
 static void sample_event_notify_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->notify_type = lookup_enum(desc, type);
+	info->notify_type = lookup_enum(info->eon, desc, type);
 }
 
 static void sample_event_notify_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -714,7 +735,7 @@ static void sample_event_notify_value(const struct type_desc *desc, struct sampl
 
 static void sample_event_warning_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->warning_type = lookup_enum(desc, type);
+	info->warning_type = lookup_enum(info->eon, desc, type);
 }
 
 static void sample_event_warning_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -736,7 +757,7 @@ static void sample_event_warning_value(const struct type_desc *desc, struct samp
 
 static void sample_event_alarm_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->alarm_type = lookup_enum(desc, type);
+	info->alarm_type = lookup_enum(info->eon, desc, type);
 }
 
 
@@ -761,7 +782,7 @@ static void sample_event_alarm_value(const struct type_desc *desc, struct sample
 static void sample_setpoint_type(const struct type_desc *desc, struct sample_data *info, unsigned char value)
 {
 	dc_sample_value_t sample = {0};
-	const char *type = lookup_enum(desc, value);
+	const char *type = lookup_enum(info->eon, desc, value);
 
 	if (!type) {
 		DEBUG(info->eon->base.context, "sample_setpoint_type(%u) did not match anything in %s", value, desc->format);
@@ -776,12 +797,10 @@ static void sample_setpoint_type(const struct type_desc *desc, struct sample_dat
 		sample.ppo2 = info->eon->cache.customsetpoint;
 	else {
 		DEBUG(info->eon->base.context, "sample_setpoint_type(%u) unknown type '%s'", value, type);
-		free((void *)type);
 		return;
 	}
 
 	if (info->callback) info->callback(DC_SAMPLE_SETPOINT, sample, info->userdata);
-	free((void *)type);
 }
 
 // uint32
@@ -1111,7 +1130,7 @@ static int add_gas_type(suunto_eonsteel_parser_t *eon, const struct type_desc *d
 		return 0;
 
 	eon->cache.ngases = idx+1;
-	name = lookup_enum(desc, type);
+	name = lookup_enum(eon, desc, type);
 	if (!name)
 		DEBUG(eon->base.context, "Unable to look up gas type %u in %s", type, desc->format);
 	else if (!strcasecmp(name, "Diluent"))
@@ -1127,7 +1146,6 @@ static int add_gas_type(suunto_eonsteel_parser_t *eon, const struct type_desc *d
 
 	eon->cache.initialized |= 1 << DC_FIELD_GASMIX_COUNT;
 	eon->cache.initialized |= 1 << DC_FIELD_TANK_COUNT;
-	free((void *)name);
 	return 0;
 }
 
@@ -1180,7 +1198,7 @@ static int add_string(suunto_eonsteel_parser_t *eon, const char *desc, const cha
 		if (str->desc)
 			continue;
 		str->desc = desc;
-		str->value = strdup(value);
+		str->value = dc_parser_strdup(&eon->base, value);
 		break;
 	}
 	return 0;
@@ -1526,23 +1544,12 @@ suunto_eonsteel_parser_set_data(dc_parser_t *parser, const unsigned char *data,
 {
 	suunto_eonsteel_parser_t *eon = (suunto_eonsteel_parser_t *) parser;
 
-	desc_free(eon->type_desc, MAXTYPE);
 	memset(eon->type_desc, 0, sizeof(eon->type_desc));
 	initialize_field_caches(eon);
 	show_all_descriptors(eon);
 	return DC_STATUS_SUCCESS;
 }
 
-static dc_status_t
-suunto_eonsteel_parser_destroy(dc_parser_t *parser)
-{
-	suunto_eonsteel_parser_t *eon = (suunto_eonsteel_parser_t *) parser;
-
-	desc_free(eon->type_desc, MAXTYPE);
-
-	return DC_STATUS_SUCCESS;
-}
-
 static const dc_parser_vtable_t suunto_eonsteel_parser_vtable = {
 	sizeof(suunto_eonsteel_parser_t),
 	DC_FAMILY_SUUNTO_EONSTEEL,
@@ -1550,7 +1557,7 @@ static const dc_parser_vtable_t suunto_eonsteel_parser_vtable = {
 	suunto_eonsteel_parser_get_datetime, /* datetime */
 	suunto_eonsteel_parser_get_field, /* fields */
 	suunto_eonsteel_parser_samples_foreach, /* samples_foreach */
-	suunto_eonsteel_parser_destroy /* destroy */
+	NULL /* destroy */
 };
 
 dc_status_t
@@ -36,7 +36,6 @@
 
 typedef struct suunto_vyper2_device_t {
 	suunto_common2_device_t base;
-	dc_iostream_t *iostream;
 	dc_timer_t *timer;
 } suunto_vyper2_device_t;
 
@@ -94,9 +93,6 @@ suunto_vyper2_device_open (dc_device_t **out, dc_context_t *context, const char
 	// Initialize the base class.
 	suunto_common2_device_init (&device->base);
 
-	// Set the default values.
-	device->iostream = NULL;
-
 	// Create a high resolution timer.
 	status = dc_timer_new (&device->timer);
 	if (status != DC_STATUS_SUCCESS) {
@@ -105,38 +101,41 @@ suunto_vyper2_device_open (dc_device_t **out, dc_context_t *context, const char
 	}
 
 	// Open the device.
-	status = dc_serial_open (&device->iostream, context, name);
+	status = dc_serial_open (&device->base.iostream, context, name);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to open the serial port.");
 		goto error_timer_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->base.iostream);
+
 	// Set the serial communication protocol (9600 8N1).
-	status = dc_iostream_configure (device->iostream, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
+	status = dc_iostream_configure (device->base.iostream, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to set the terminal attributes.");
 		goto error_close;
 	}
 
 	// Set the timeout for receiving data (3000 ms).
-	status = dc_iostream_set_timeout (device->iostream, 3000);
+	status = dc_iostream_set_timeout (device->base.iostream, 3000);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to set the timeout.");
 		goto error_close;
 	}
 
 	// Set the DTR line (power supply for the interface).
-	status = dc_iostream_set_dtr (device->iostream, 1);
+	status = dc_iostream_set_dtr (device->base.iostream, 1);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to set the DTR line.");
 		goto error_close;
 	}
 
 	// Give the interface 100 ms to settle and draw power up.
-	dc_iostream_sleep (device->iostream, 100);
+	dc_iostream_sleep (device->base.iostream, 100);
 
 	// Make sure everything is in a sane state.
-	status = dc_iostream_purge (device->iostream, DC_DIRECTION_ALL);
+	status = dc_iostream_purge (device->base.iostream, DC_DIRECTION_ALL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to reset IO state.");
 		goto error_close;
@@ -161,7 +160,7 @@ suunto_vyper2_device_open (dc_device_t **out, dc_context_t *context, const char
 	return DC_STATUS_SUCCESS;
 
 error_close:
-	dc_iostream_close (device->iostream);
+	dc_iostream_close (device->base.iostream);
 error_timer_free:
 	dc_timer_free (device->timer);
 error_free:
@@ -180,7 +179,7 @@ suunto_vyper2_device_close (dc_device_t *abstract)
 	dc_timer_free (device->timer);
 
 	// Close the device.
-	rc = dc_iostream_close (device->iostream);
+	rc = dc_iostream_close (device->base.iostream);
 	if (rc != DC_STATUS_SUCCESS) {
 		dc_status_set_error(&status, rc);
 	}
@@ -198,10 +197,10 @@ suunto_vyper2_device_packet (dc_device_t *abstract, const unsigned char command[
 	if (device_is_cancelled (abstract))
 		return DC_STATUS_CANCELLED;
 
-	dc_iostream_sleep (device->iostream, 600);
+	dc_iostream_sleep (device->base.iostream, 600);
 
 	// Set RTS to send the command.
-	status = dc_iostream_set_rts (device->iostream, 1);
+	status = dc_iostream_set_rts (device->base.iostream, 1);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to set the RTS line.");
 		return status;
@@ -215,7 +214,7 @@ suunto_vyper2_device_packet (dc_device_t *abstract, const unsigned char command[
 	}
 
 	// Send the command to the dive computer.
-	status = dc_iostream_write (device->iostream, command, csize, NULL);
+	status = dc_iostream_write (device->base.iostream, command, csize, NULL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to send the command.");
 		return status;
@@ -246,18 +245,18 @@ suunto_vyper2_device_packet (dc_device_t *abstract, const unsigned char command[
 		// resolution on all platforms. The higher resolution is
 		// pointless anyway, since we already added a fudge factor
 		// above.
-		dc_iostream_sleep (device->iostream, (remaining + 999) / 1000);
+		dc_iostream_sleep (device->base.iostream, (remaining + 999) / 1000);
 	}
 
 	// Clear RTS to receive the reply.
-	status = dc_iostream_set_rts (device->iostream, 0);
+	status = dc_iostream_set_rts (device->base.iostream, 0);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to set the RTS line.");
 		return status;
 	}
 
 	// Receive the answer of the dive computer.
-	status = dc_iostream_read (device->iostream, answer, asize, NULL);
+	status = dc_iostream_read (device->base.iostream, answer, asize, NULL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to receive the answer.");
 		return status;
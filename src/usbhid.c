@@ -24,6 +24,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #ifdef HAVE_PTHREAD_H
 #include <pthread.h>
 #endif
@@ -57,6 +58,7 @@
 #include "descriptor-private.h"
 #include "iterator-private.h"
 #include "platform.h"
+#include "timer.h"
 
 #ifdef _WIN32
 typedef LONG dc_mutex_t;
@@ -68,6 +70,18 @@ typedef pthread_mutex_t dc_mutex_t;
 
 #define ISINSTANCE(device) dc_iostream_isinstance((device), &dc_usbhid_vtable)
 
+#if defined(USE_LIBUSB)
+// Number of asynchronous IN transfers that are kept submitted. With more
+// than one transfer pending, the host can poll the interrupt endpoint at
+// its maximum rate, even while the previous report is being processed.
+#ifndef USBHID_NTRANSFERS
+#define USBHID_NTRANSFERS 4
+#endif
+
+// Number of received reports that can be queued.
+#define USBHID_NREPORTS   (8 * USBHID_NTRANSFERS)
+#endif
+
 struct dc_usbhid_device_t {
 	unsigned short vid, pid;
 };
@@ -79,6 +93,7 @@ static dc_status_t dc_usbhid_iterator_free (dc_iterator_t *iterator);
 static dc_status_t dc_usbhid_set_timeout (dc_iostream_t *iostream, int timeout);
 static dc_status_t dc_usbhid_read (dc_iostream_t *iostream, void *data, size_t size, size_t *actual);
 static dc_status_t dc_usbhid_write (dc_iostream_t *iostream, const void *data, size_t size, size_t *actual);
+static dc_status_t dc_usbhid_purge (dc_iostream_t *iostream, dc_direction_t direction);
 static dc_status_t dc_usbhid_close (dc_iostream_t *iostream);
 
 typedef struct dc_usbhid_iterator_t {
@@ -103,6 +118,23 @@ typedef struct dc_usbhid_t {
 	unsigned char endpoint_in;
 	unsigned char endpoint_out;
 	unsigned int timeout;
+	unsigned int interval;
+	unsigned int packetsize;
+	/* Asynchronous IN transfers. */
+	struct libusb_transfer *transfers[USBHID_NTRANSFERS];
+	struct libusb_transfer *idle[USBHID_NTRANSFERS];
+	unsigned int nidle;
+	unsigned int nactive;
+	unsigned int cancel;
+	dc_status_t status;
+	/* Queue with the received reports. */
+	unsigned char *reports;
+	unsigned int lengths[USBHID_NREPORTS];
+	unsigned int head, count;
+	/* Report rate statistics. */
+	dc_timer_t *timer;
+	unsigned int nreports;
+	dc_usecs_t first, last;
 #elif defined(USE_HIDAPI)
 	hid_device *handle;
 	int timeout;
@@ -128,7 +160,7 @@ static const dc_iostream_vtable_t dc_usbhid_vtable = {
 	dc_usbhid_read, /* read */
 	dc_usbhid_write, /* write */
 	NULL, /* flush */
-	NULL, /* purge */
+	dc_usbhid_purge, /* purge */
 	NULL, /* sleep */
 	dc_usbhid_close, /* close */
 };
@@ -160,82 +192,107 @@ syserror(int errcode)
 		return DC_STATUS_IO;
 	}
 }
-#endif
 
 static dc_status_t
-usbhid_packet_close(dc_custom_io_t *io)
+dc_usbhid_submit (dc_usbhid_t *usbhid)
 {
-	dc_iostream_t *usbhid = (dc_iostream_t *)io->userdata;
-	return dc_usbhid_close(usbhid);
-}
+	// Keep as many transfers submitted as there is free space in the
+	// report queue. This guarantees every completed transfer can be
+	// queued without losing any data.
+	while (usbhid->nidle && !usbhid->cancel && usbhid->status == DC_STATUS_SUCCESS &&
+		usbhid->count + usbhid->nactive < USBHID_NREPORTS)
+	{
+		struct libusb_transfer *transfer = usbhid->idle[usbhid->nidle - 1];
+		int rc = libusb_submit_transfer (transfer);
+		if (rc != LIBUSB_SUCCESS) {
+			ERROR (usbhid->base.context, "Failed to submit the usb transfer (%s).",
+				libusb_error_name (rc));
+			return syserror (rc);
+		}
 
-static dc_status_t
-usbhid_packet_read(dc_custom_io_t *io, void* data, size_t size, size_t *actual)
-{
-	dc_iostream_t *usbhid = (dc_iostream_t *)io->userdata;
-	return dc_usbhid_read(usbhid, data, size, actual);
-}
+		usbhid->nidle--;
+		usbhid->nactive++;
+	}
 
-/*
- * FIXME! The USB HID "report type" is a disaster, and there's confusion
- * between libusb and HIDAPI. The Scubapro G2 seems to need an explicit
- * report type of 0 for HIDAPI, but not for libusb.
- *
- * See commit d251b37 ("Add a zero report ID to the commands") for the
- * Scubapro G2 - but that doesn't actually work with the BLE case, so
- * I really suspect that we need to do something _here_ in the packet
- * IO layer, and have the USBHID registration set the report type to
- * use (ie an extra new argument to dc_usbhid_custom_io() to set the
- * report type, or something).
- *
- * The Suunto EON Steel just uses 0x3f and does that in the caller.
- */
-static dc_status_t
-usbhid_packet_write(dc_custom_io_t *io, const void* data, size_t size, size_t *actual)
-{
-	dc_iostream_t *usbhid = (dc_iostream_t *)io->userdata;
-	return dc_usbhid_write(usbhid, data, size, actual);
+	return DC_STATUS_SUCCESS;
 }
 
-dc_status_t
-dc_usbhid_custom_io (dc_context_t *context, unsigned int vid, unsigned int pid)
+static void LIBUSB_CALL
+dc_usbhid_callback (struct libusb_transfer *transfer)
 {
-	dc_iostream_t *usbhid;
-	dc_status_t status;
-
-	static dc_custom_io_t custom = {
-		.packet_size = 64,
-		.packet_close = usbhid_packet_close,
-		.packet_read  = usbhid_packet_read,
-		.packet_write = usbhid_packet_write,
-	};
+	dc_usbhid_t *usbhid = (dc_usbhid_t *) transfer->user_data;
+
+	usbhid->nactive--;
+
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		if (transfer->actual_length > 0) {
+			// Append the report to the queue.
+			unsigned int idx = (usbhid->head + usbhid->count) % USBHID_NREPORTS;
+			memcpy (usbhid->reports + idx * usbhid->packetsize, transfer->buffer, transfer->actual_length);
+			usbhid->lengths[idx] = transfer->actual_length;
+			usbhid->count++;
+
+			// Update the report rate statistics.
+			dc_usecs_t now = 0;
+			dc_timer_now (usbhid->timer, &now);
+			if (usbhid->nreports == 0)
+				usbhid->first = now;
+			usbhid->last = now;
+			usbhid->nreports++;
+		}
+		break;
+	case LIBUSB_TRANSFER_CANCELLED:
+		break;
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		if (usbhid->status == DC_STATUS_SUCCESS)
+			usbhid->status = DC_STATUS_NODEVICE;
+		break;
+	default:
+		if (usbhid->status == DC_STATUS_SUCCESS)
+			usbhid->status = DC_STATUS_IO;
+		break;
+	}
 
-	status = dc_usbhid_open(&usbhid, context, vid, pid);
-	if (status != DC_STATUS_SUCCESS)
-		return status;
+	usbhid->idle[usbhid->nidle++] = transfer;
 
-	custom.userdata = (void *)usbhid;
-	dc_context_set_custom_io(context, &custom, NULL);
+	// Resubmit the transfer. A failure is picked up again by the
+	// next read, which retries the submission.
+	dc_usbhid_submit (usbhid);
+}
 
-	dc_usbhid_set_timeout(usbhid, 10);
+static void
+dc_usbhid_cancel (dc_usbhid_t *usbhid)
+{
+	usbhid->cancel = 1;
 
-	/* Get rid of any pending stale input first */
-	/* NOTE! This will cause an annoying warning from dc_usbhid_read() */
-	for (;;) {
-		size_t transferred = 0;
-		unsigned char buf[64];
+	// Cancel all pending transfers. Transfers which are not
+	// submitted are simply ignored by libusb.
+	for (unsigned int i = 0; i < USBHID_NTRANSFERS; ++i) {
+		if (usbhid->transfers[i])
+			libusb_cancel_transfer (usbhid->transfers[i]);
+	}
 
-		dc_status_t rc = dc_usbhid_read(usbhid, buf, sizeof(buf), &transferred);
-		if (rc != DC_STATUS_SUCCESS)
-			break;
-		if (!transferred)
+	// Wait for the cancellations to complete.
+	while (usbhid->nactive) {
+		int rc = libusb_handle_events_completed (g_usbhid_ctx, NULL);
+		if (rc != LIBUSB_SUCCESS && rc != LIBUSB_ERROR_INTERRUPTED)
 			break;
 	}
+}
 
-	dc_usbhid_set_timeout(usbhid, 5000);
+static void
+dc_usbhid_free_transfers (dc_usbhid_t *usbhid)
+{
+	for (unsigned int i = 0; i < USBHID_NTRANSFERS; ++i) {
+		libusb_free_transfer (usbhid->transfers[i]);
+		usbhid->transfers[i] = NULL;
+	}
 
-	return DC_STATUS_SUCCESS;
+	free (usbhid->reports);
+	usbhid->reports = NULL;
 }
+#endif
 
 static void
 dc_mutex_lock (dc_mutex_t *mutex)
@@ -538,6 +595,11 @@ dc_usbhid_iterator_free (dc_iterator_t *abstract)
 dc_status_t
 dc_usbhid_open (dc_iostream_t **out, dc_context_t *context, unsigned int vid, unsigned int pid)
 {
+	// Are we replaying a capture file?
+	dc_capture_t *capture = _dc_context_capture (context);
+	if (dc_capture_isreplay (capture))
+		return dc_capture_open (out, context, capture);
+
 #ifdef USBHID
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_usbhid_t *usbhid = NULL;
@@ -651,10 +713,35 @@ dc_usbhid_open (dc_iostream_t **out, dc_context_t *context, unsigned int vid, un
 		goto error_usb_free_config;
 	}
 
+	// Get the maximum packet size of the input endpoint.
+	rc = libusb_get_max_packet_size (device, ep_in->bEndpointAddress);
+	if (rc <= 0) {
+		ERROR (context, "Failed to get the maximum packet size (%s).",
+			libusb_error_name (rc));
+		status = syserror (rc);
+		goto error_usb_free_config;
+	}
+
 	usbhid->interface = interface->bInterfaceNumber;
 	usbhid->endpoint_in = ep_in->bEndpointAddress;
 	usbhid->endpoint_out = ep_out->bEndpointAddress;
 	usbhid->timeout = 0;
+	usbhid->interval = ep_in->bInterval;
+	usbhid->packetsize = rc & 0x7FF; // Strip the high bandwidth bits.
+	usbhid->nidle = 0;
+	usbhid->nactive = 0;
+	usbhid->cancel = 0;
+	usbhid->status = DC_STATUS_SUCCESS;
+	usbhid->reports = NULL;
+	usbhid->head = 0;
+	usbhid->count = 0;
+	usbhid->timer = NULL;
+	usbhid->nreports = 0;
+	usbhid->first = 0;
+	usbhid->last = 0;
+	for (unsigned int i = 0; i < USBHID_NTRANSFERS; ++i) {
+		usbhid->transfers[i] = NULL;
+	}
 
 	INFO (context, "Open: interface=%u, endpoints=%02x,%02x",
 		usbhid->interface, usbhid->endpoint_in, usbhid->endpoint_out);
@@ -681,6 +768,47 @@ dc_usbhid_open (dc_iostream_t **out, dc_context_t *context, unsigned int vid, un
 		goto error_usb_close;
 	}
 
+	// Create the timer for the report rate statistics.
+	status = dc_timer_new (&usbhid->timer);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (context, "Failed to create a high resolution timer.");
+		goto error_usb_release;
+	}
+
+	// Allocate the report queue.
+	usbhid->reports = (unsigned char *) malloc (USBHID_NREPORTS * usbhid->packetsize);
+	if (usbhid->reports == NULL) {
+		ERROR (context, "Out of memory.");
+		status = DC_STATUS_NOMEMORY;
+		goto error_timer_free;
+	}
+
+	// Allocate the IN transfers.
+	for (unsigned int i = 0; i < USBHID_NTRANSFERS; ++i) {
+		unsigned char *buffer = (unsigned char *) malloc (usbhid->packetsize);
+		struct libusb_transfer *transfer = libusb_alloc_transfer (0);
+		if (buffer == NULL || transfer == NULL) {
+			ERROR (context, "Out of memory.");
+			libusb_free_transfer (transfer);
+			free (buffer);
+			status = DC_STATUS_NOMEMORY;
+			goto error_transfers_free;
+		}
+
+		libusb_fill_interrupt_transfer (transfer, usbhid->handle, usbhid->endpoint_in,
+			buffer, usbhid->packetsize, dc_usbhid_callback, usbhid, 0);
+		transfer->flags |= LIBUSB_TRANSFER_FREE_BUFFER;
+
+		usbhid->transfers[i] = transfer;
+		usbhid->idle[usbhid->nidle++] = transfer;
+	}
+
+	// Start receiving reports.
+	status = dc_usbhid_submit (usbhid);
+	if (status != DC_STATUS_SUCCESS) {
+		goto error_transfers_cancel;
+	}
+
 	libusb_free_config_descriptor (config);
 	libusb_free_device_list (devices, 1);
 
@@ -701,6 +829,14 @@ dc_usbhid_open (dc_iostream_t **out, dc_context_t *context, unsigned int vid, un
 	return DC_STATUS_SUCCESS;
 
 #if defined(USE_LIBUSB)
+error_transfers_cancel:
+	dc_usbhid_cancel (usbhid);
+error_transfers_free:
+	dc_usbhid_free_transfers (usbhid);
+error_timer_free:
+	dc_timer_free (usbhid->timer);
+error_usb_release:
+	libusb_release_interface (usbhid->handle, usbhid->interface);
 error_usb_close:
 	libusb_close (usbhid->handle);
 error_usb_free_config:
@@ -726,6 +862,18 @@ dc_usbhid_close (dc_iostream_t *abstract)
 	dc_usbhid_t *usbhid = (dc_usbhid_t *) abstract;
 
 #if defined(USE_LIBUSB)
+	dc_usbhid_cancel (usbhid);
+
+	if (usbhid->nreports > 1 && usbhid->last > usbhid->first) {
+		dc_usecs_t elapsed = usbhid->last - usbhid->first;
+		INFO (abstract->context, "Read: reports=%u, rate=%u/s, interval=%u",
+			usbhid->nreports,
+			(unsigned int) ((usbhid->nreports - 1) * 1000000ULL / elapsed),
+			usbhid->interval);
+	}
+
+	dc_usbhid_free_transfers (usbhid);
+	dc_timer_free (usbhid->timer);
 	libusb_release_interface (usbhid->handle, usbhid->interface);
 	libusb_close (usbhid->handle);
 #elif defined(USE_HIDAPI)
@@ -768,13 +916,82 @@ dc_usbhid_read (dc_iostream_t *abstract, void *data, size_t size, size_t *actual
 	int nbytes = 0;
 
 #if defined(USE_LIBUSB)
-	int rc = libusb_interrupt_transfer (usbhid->handle, usbhid->endpoint_in, data, size, &nbytes, usbhid->timeout);
-	if (rc != LIBUSB_SUCCESS) {
-		ERROR (abstract->context, "Usb read interrupt transfer failed (%s).",
-			libusb_error_name (rc));
-		status = syserror (rc);
-		goto out;
+	// The absolute target time.
+	dc_usecs_t target = 0;
+
+	int init = 1;
+	while (usbhid->count == 0) {
+		// Report any error once all queued reports are consumed.
+		if (usbhid->status != DC_STATUS_SUCCESS) {
+			ERROR (abstract->context, "Usb read interrupt transfer failed.");
+			status = usbhid->status;
+			goto out;
+		}
+
+		// Resubmit the transfers that are not pending anymore.
+		status = dc_usbhid_submit (usbhid);
+		if (status != DC_STATUS_SUCCESS) {
+			goto out;
+		}
+
+		struct timeval tv;
+		if (usbhid->timeout > 0) {
+			dc_usecs_t timeout = 0;
+
+			dc_usecs_t now = 0;
+			status = dc_timer_now (usbhid->timer, &now);
+			if (status != DC_STATUS_SUCCESS) {
+				goto out;
+			}
+
+			if (init) {
+				// Calculate the initial timeout.
+				timeout = usbhid->timeout * 1000;
+				// Calculate the target time.
+				target = now + timeout;
+				init = 0;
+			} else {
+				// Calculate the remaining timeout.
+				if (now < target) {
+					timeout = target - now;
+				} else {
+					ERROR (abstract->context, "Usb read interrupt transfer failed (%s).",
+						libusb_error_name (LIBUSB_ERROR_TIMEOUT));
+					status = DC_STATUS_TIMEOUT;
+					goto out;
+				}
+			}
+			tv.tv_sec  = timeout / 1000000;
+			tv.tv_usec = timeout % 1000000;
+		} else {
+			// Wait indefinitely.
+			tv.tv_sec  = 1;
+			tv.tv_usec = 0;
+		}
+
+		int rc = libusb_handle_events_timeout_completed (g_usbhid_ctx, &tv, NULL);
+		if (rc != LIBUSB_SUCCESS && rc != LIBUSB_ERROR_INTERRUPTED) {
+			ERROR (abstract->context, "Failed to handle the usb events (%s).",
+				libusb_error_name (rc));
+			status = syserror (rc);
+			goto out;
+		}
 	}
+
+	// Take the oldest report from the queue.
+	unsigned int length = usbhid->lengths[usbhid->head];
+	if (length > size) {
+		ERROR (abstract->context, "Report exceeds the buffer size (%u > " DC_PRINTF_SIZE ").", length, size);
+		status = DC_STATUS_PROTOCOL;
+		length = size;
+	}
+	memcpy (data, usbhid->reports + usbhid->head * usbhid->packetsize, length);
+	usbhid->head = (usbhid->head + 1) % USBHID_NREPORTS;
+	usbhid->count--;
+	nbytes = length;
+
+	// Resubmit the transfers that were waiting for free queue space.
+	dc_usbhid_submit (usbhid);
 #elif defined(USE_HIDAPI)
 	nbytes = hid_read_timeout(usbhid->handle, data, size, usbhid->timeout);
 	if (nbytes < 0) {
@@ -848,12 +1065,123 @@ out:
 
 	return status;
 }
-#else /* !USBHID */
 
-dc_status_t
-dc_usbhid_custom_io (dc_context_t *context, unsigned int vid, unsigned int pid)
+static dc_status_t
+dc_usbhid_purge (dc_iostream_t *abstract, dc_direction_t direction)
 {
-	return DC_STATUS_UNSUPPORTED;
-}
+	dc_usbhid_t *usbhid = (dc_usbhid_t *) abstract;
+
+	// The interrupt transfers are written synchronously, so only the
+	// received reports need to be discarded.
+	if ((direction & DC_DIRECTION_INPUT) == 0)
+		return DC_STATUS_SUCCESS;
+
+#if defined(USE_LIBUSB)
+	// Pick up the transfers that have already completed.
+	struct timeval tv = {0, 0};
+	int rc = libusb_handle_events_timeout_completed (g_usbhid_ctx, &tv, NULL);
+	if (rc != LIBUSB_SUCCESS && rc != LIBUSB_ERROR_INTERRUPTED) {
+		ERROR (abstract->context, "Failed to handle the usb events (%s).",
+			libusb_error_name (rc));
+		return syserror (rc);
+	}
+
+	// Drop all queued reports.
+	usbhid->head = 0;
+	usbhid->count = 0;
 
+	// Resubmit the transfers that were waiting for free queue space.
+	dc_usbhid_submit (usbhid);
+#elif defined(USE_HIDAPI)
+	unsigned char buffer[256];
+	while (hid_read_timeout (usbhid->handle, buffer, sizeof (buffer), 0) > 0)
+		;
+#endif
+
+	return DC_STATUS_SUCCESS;
+}
 #endif
+
+/*
+ * The packet helpers go through the generic I/O stream functions, because
+ * the stream is not necessarily a usbhid stream. When replaying a capture
+ * file, dc_usbhid_open returns a replay stream instead. The generic
+ * functions also take care of recording the transfers.
+ */
+static dc_status_t
+usbhid_packet_close(dc_custom_io_t *io)
+{
+	dc_iostream_t *usbhid = (dc_iostream_t *)io->userdata;
+	return dc_iostream_close(usbhid);
+}
+
+static dc_status_t
+usbhid_packet_read(dc_custom_io_t *io, void* data, size_t size, size_t *actual)
+{
+	dc_iostream_t *usbhid = (dc_iostream_t *)io->userdata;
+	return dc_iostream_read(usbhid, data, size, actual);
+}
+
+/*
+ * FIXME! The USB HID "report type" is a disaster, and there's confusion
+ * between libusb and HIDAPI. The Scubapro G2 seems to need an explicit
+ * report type of 0 for HIDAPI, but not for libusb.
+ *
+ * See commit d251b37 ("Add a zero report ID to the commands") for the
+ * Scubapro G2 - but that doesn't actually work with the BLE case, so
+ * I really suspect that we need to do something _here_ in the packet
+ * IO layer, and have the USBHID registration set the report type to
+ * use (ie an extra new argument to dc_usbhid_custom_io() to set the
+ * report type, or something).
+ *
+ * The Suunto EON Steel just uses 0x3f and does that in the caller.
+ */
+static dc_status_t
+usbhid_packet_write(dc_custom_io_t *io, const void* data, size_t size, size_t *actual)
+{
+	dc_iostream_t *usbhid = (dc_iostream_t *)io->userdata;
+	return dc_iostream_write(usbhid, data, size, actual);
+}
+
+dc_status_t
+dc_usbhid_custom_io (dc_iostream_t **iostream, dc_context_t *context, unsigned int vid, unsigned int pid)
+{
+	dc_iostream_t *usbhid;
+	dc_status_t status;
+
+	static dc_custom_io_t custom = {
+		.packet_size = 64,
+		.packet_close = usbhid_packet_close,
+		.packet_read  = usbhid_packet_read,
+		.packet_write = usbhid_packet_write,
+	};
+
+	status = dc_usbhid_open(&usbhid, context, vid, pid);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	custom.userdata = (void *)usbhid;
+	dc_context_set_custom_io(context, &custom, NULL);
+
+	dc_iostream_set_timeout(usbhid, 10);
+
+	/* Get rid of any pending stale input first */
+	/* NOTE! This will cause an annoying warning from dc_usbhid_read() */
+	for (;;) {
+		size_t transferred = 0;
+		unsigned char buf[64];
+
+		dc_status_t rc = dc_iostream_read(usbhid, buf, sizeof(buf), &transferred);
+		if (rc != DC_STATUS_SUCCESS)
+			break;
+		if (!transferred)
+			break;
+	}
+
+	dc_iostream_set_timeout(usbhid, 5000);
+
+	if (iostream)
+		*iostream = usbhid;
+
+	return DC_STATUS_SUCCESS;
+}
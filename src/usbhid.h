@@ -86,9 +86,10 @@ dc_usbhid_iterator_new (dc_iterator_t **iterator, dc_context_t *context, dc_desc
 dc_status_t
 dc_usbhid_open (dc_iostream_t **iostream, dc_context_t *context, unsigned int vid, unsigned int pid);
 
-/* Create a dc_custom_io_t that uses usbhid for packet transfer */
+/* Create a dc_custom_io_t that uses usbhid for packet transfer. The
+ * underlying stream is returned in the optional iostream parameter. */
 dc_status_t
-dc_usbhid_custom_io(dc_context_t *context, unsigned int vid, unsigned int pid);
+dc_usbhid_custom_io(dc_iostream_t **iostream, dc_context_t *context, unsigned int vid, unsigned int pid);
 
 #ifdef __cplusplus
 }
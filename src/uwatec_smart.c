@@ -206,6 +206,9 @@ uwatec_smart_device_open (dc_device_t **out, dc_context_t *context)
 		goto error_device_free;
 	}
 
+	// Collect the transfer statistics.
+	device_statistics_attach ((dc_device_t *) device, device->iostream);
+
 	// Perform the handshaking.
 	status = uwatec_smart_handshake (device);
 	if (status != DC_STATUS_SUCCESS) {
@@ -946,6 +946,9 @@ uwatec_smart_parse (uwatec_smart_parser_t *parser, dc_sample_callback_t callback
 	int have_depth = 0, have_temperature = 0, have_pressure = 0, have_rbt = 0,
 		have_heartrate = 0, have_bearing = 0;
 
+	// Get the requested sample types.
+	unsigned int mask = callback ? abstract->activemask : 0;
+
 	unsigned int offset = parser->headersize;
 	while (offset < size) {
 		dc_sample_value_t sample = {0};
@@ -1166,7 +1169,7 @@ uwatec_smart_parse (uwatec_smart_parser_t *parser, dc_sample_callback_t callback
 
 		while (complete) {
 			sample.time = time;
-			if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
+			if (mask & DC_SAMPLE_MASK (DC_SAMPLE_TIME)) callback (DC_SAMPLE_TIME, sample, userdata);
 
 			if (parser->ngasmixes && gasmix != gasmix_previous) {
 				idx = uwatec_smart_find_gasmix (parser, gasmix);
@@ -1175,13 +1178,13 @@ uwatec_smart_parse (uwatec_smart_parser_t *parser, dc_sample_callback_t callback
 					return DC_STATUS_DATAFORMAT;
 				}
 				sample.gasmix = idx;
-				if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_GASMIX)) callback (DC_SAMPLE_GASMIX, sample, userdata);
 				gasmix_previous = gasmix;
 			}
 
 			if (have_temperature) {
 				sample.temperature = temperature;
-				if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_TEMPERATURE)) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 			}
 
 			if (bookmark) {
@@ -1189,37 +1192,37 @@ uwatec_smart_parse (uwatec_smart_parser_t *parser, dc_sample_callback_t callback
 				sample.event.time = 0;
 				sample.event.flags = 0;
 				sample.event.value = 0;
-				if (callback) callback (DC_SAMPLE_EVENT, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_EVENT)) callback (DC_SAMPLE_EVENT, sample, userdata);
 			}
 
 			if (have_rbt || have_pressure) {
 				sample.rbt = rbt;
-				if (callback) callback (DC_SAMPLE_RBT, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_RBT)) callback (DC_SAMPLE_RBT, sample, userdata);
 			}
 
-			if (have_pressure) {
+			if (have_pressure && (mask & DC_SAMPLE_MASK (DC_SAMPLE_PRESSURE))) {
 				idx = uwatec_smart_find_tank(parser, tank);
 				if (idx < parser->ntanks) {
 					sample.pressure.tank = idx;
 					sample.pressure.value = pressure;
-					if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
+					callback (DC_SAMPLE_PRESSURE, sample, userdata);
 				}
 			}
 
 			if (have_heartrate) {
 				sample.heartbeat = heartrate;
-				if (callback) callback (DC_SAMPLE_HEARTBEAT, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_HEARTBEAT)) callback (DC_SAMPLE_HEARTBEAT, sample, userdata);
 			}
 
 			if (have_bearing) {
 				sample.bearing = bearing;
-				if (callback) callback (DC_SAMPLE_BEARING, sample, userdata);
+				if (mask & DC_SAMPLE_MASK (DC_SAMPLE_BEARING)) callback (DC_SAMPLE_BEARING, sample, userdata);
 				have_bearing = 0;
 			}
 
-			if (have_depth) {
+			if (have_depth && (mask & DC_SAMPLE_MASK (DC_SAMPLE_DEPTH))) {
 				sample.depth = (depth - depth_calibration) / salinity;
-				if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
+				callback (DC_SAMPLE_DEPTH, sample, userdata);
 			}
 
 			time += interval;